@@ -0,0 +1,35 @@
+#shader vertex
+#version 330 core
+
+// Full screen quad, already in clip space
+layout(location = 0) in vec2 a_Position;
+layout(location = 1) in vec2 a_TexCoord;
+
+void main()
+{
+    gl_Position = vec4(a_Position, 0.0, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+out vec4 FragColor;
+
+// One texel per pixel of the viewport, filled by ParticleRenderer on the CPU
+// r: area of the particles around the pixel (bilinear weights) over the pixel area
+// g: their mean speed, weighted by area
+uniform sampler2D u_Density;
+
+void main()
+{
+    vec2 density = texelFetch(u_Density, ivec2(gl_FragCoord.xy), 0).rg;
+    if (density.r <= 0.0) discard;
+
+    // Same ramp as ParticleShader
+    float t = 4.0 * min(density.g / 200.0, 1.0);
+    vec3 colorRGB = clamp(vec3(t - 2.0, min(t, 4.0 - t), 2.0 - t), 0.0, 1.0);
+
+    // Colliding discs don't overlap, their area is the covered fraction of the pixel.
+    // A sparse pixel lets the background through
+    FragColor = vec4(colorRGB, min(density.r, 1.0));
+}
@@ -0,0 +1,52 @@
+#shader vertex
+#version 330 core
+
+// One point per particle, straight from the instance data
+layout(location = 2) in vec2 a_ParticlePos; // Particle center position
+layout(location = 3) in vec2 a_Velocity;    // Particle velocity
+layout(location = 4) in float a_Size;       // Particle size
+
+out vec3 v_Color;
+
+uniform mat4 u_MVP;
+uniform float u_PixelsPerUnit;  // Viewport pixels per world unit, horizontally
+
+void main()
+{
+    gl_Position = u_MVP * vec4(a_ParticlePos, 0.0, 1.0);
+
+    // Points are square, a_Size is the radius
+    gl_PointSize = 2.0 * a_Size * u_PixelsPerUnit;
+
+    // Once per point, same ramp as ParticleShader
+    float t = 4.0 * min(length(a_Velocity) / 200.0, 1.0);
+    v_Color = clamp(vec3(t - 2.0, min(t, 4.0 - t), 2.0 - t), 0.0, 1.0);
+}
+
+#shader fragment
+#version 330 core
+
+in vec3 v_Color;
+out vec4 FragColor;
+
+uniform bool u_Opaque;  // no blending, hard edged discs
+
+void main()
+{
+    // gl_PointCoord spans the point from (0, 0) to (1, 1), same circle as ParticleShader
+    vec2 offset = gl_PointCoord * 2.0 - 1.0;
+    float distanceSquared = dot(offset, offset);
+    if (distanceSquared >= 0.9613) discard;
+
+    if (u_Opaque) {
+        if (distanceSquared > 0.9025) discard;
+        FragColor = vec4(v_Color, 1.0);
+        return;
+    }
+
+    float circleShape = 1.0;
+    if (distanceSquared > 0.81)
+        circleShape = 1.0 - smoothstep(0.9, 1.0, sqrt(distanceSquared));
+
+    FragColor = vec4(v_Color, circleShape);
+}
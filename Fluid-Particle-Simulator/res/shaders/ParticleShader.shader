@@ -11,8 +11,8 @@ layout(location = 3) in vec2 a_Velocity;    // Particle velocity
 layout(location = 4) in float a_Size;       // Particle size
 
 // Outputs to fragment shader
-out vec2 v_TexCoord;
-out vec2 v_Velocity;
+out vec2 v_Offset;     // Position in the quad, the circle is of radius 1
+out vec3 v_Color;      // The same at every vertex. Not flat, llvmpipe interpolates that slower
 
 uniform mat4 u_MVP;
 
@@ -25,55 +25,42 @@ void main()
     // Transform vertex to clip space
     gl_Position = u_MVP * vec4(vertexPos, 0.0, 1.0);
     
-    // Pass texture coordinates to fragment shader
-    v_TexCoord = a_TexCoord;
+    // The quad corners are the circle's bounding square, no need for the texture coordinates
+    v_Offset = a_Position;
     
-    // Pass velocity to fragment shader
-    v_Velocity = a_Velocity;
+    // The colour is the same over the whole quad, work it out per vertex rather than per fragment.
+    // Blue, cyan, green, yellow, red from rest to 200 units/s, one linear piece every quarter
+    float t = 4.0 * min(length(a_Velocity) / 200.0, 1.0);
+    v_Color = clamp(vec3(t - 2.0, min(t, 4.0 - t), 2.0 - t), 0.0, 1.0);
 }
 
 #shader fragment
 #version 330 core
 
-in vec2 v_TexCoord;
-in vec2 v_Velocity;  
+in vec2 v_Offset;
+in vec3 v_Color;
 out vec4 FragColor;
 
+uniform bool u_Opaque;  // no blending, hard edged discs
+
 void main()
 {
-    // Calculate distance from center (0.5, 0.5) in texture space
-    vec2 center = vec2(0.5, 0.5);
-    float distance = length(v_TexCoord - center) * 2.0; // *2 to normalize to [0,1] range
-    
-    // Create a soft circle shape with smooth edges
-    float circleShape = 1.0 - smoothstep(0.9, 1.0, distance);
-
-    float speed = length(v_Velocity);
-    float normalizedV = min(speed / 200.0, 1.0);
+    // Squared distance from the center, the corners are thrown away before anything else.
+    // Past 0.9805 the soft edge below would be under 0.1 alpha
+    float distanceSquared = dot(v_Offset, v_Offset);
+    if (distanceSquared >= 0.9613) discard;
 
-    vec3 colorRGB;
-    if (normalizedV < 0.25) {
-        float t = normalizedV / 0.25;
-        colorRGB = vec3(0.0, t, 1.0);
-    }
-    else if (normalizedV < 0.5) {
-        float t = (normalizedV - 0.25) / 0.25;
-        colorRGB = vec3(0.0, 1.0, 1.0 - t);
-    }
-    else if (normalizedV < 0.75) {
-        float t = (normalizedV - 0.5) / 0.25;
-        colorRGB = vec3(t, 1.0, 0.0);
-    }
-    else {
-        float t = (normalizedV - 0.75) / 0.25;
-        colorRGB = vec3(1.0, 1.0 - t, 0.0);
+    // Without blending the edge is cut where the soft one is half transparent
+    if (u_Opaque) {
+        if (distanceSquared > 0.9025) discard;
+        FragColor = vec4(v_Color, 1.0);
+        return;
     }
-    
-    // Create the final color with alpha from the circle shape
-    vec4 finalColor = vec4(colorRGB, circleShape);
-    
-    // Discard pixels outside the circle to create a clean edge
-    if (circleShape < 0.1) discard;
-    
-    FragColor = finalColor;
-}
\ No newline at end of file
+
+    // Create a soft circle shape with smooth edges, only the rim past 0.9 needs the square root
+    float circleShape = 1.0;
+    if (distanceSquared > 0.81)
+        circleShape = 1.0 - smoothstep(0.9, 1.0, sqrt(distanceSquared));
+
+    FragColor = vec4(v_Color, circleShape);
+}
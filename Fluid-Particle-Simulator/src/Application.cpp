@@ -3,11 +3,23 @@
 
 #include "physics/SimulationSystem.h"
 #include "physics/Physics.h"
+#include "physics/EventDriven.h"
+#include "bench/BroadphaseBenchmark.h"
+#include "bench/ScalingBenchmark.h"
+#include "bench/CounterBenchmark.h"
+#include "bench/SplatBenchmark.h"
+#include "bench/DrawBenchmark.h"
+#include "bench/AllocationBenchmark.h"
 
 #include "Shader.h"
 #include "Texture.h"
 #include "core/Time.h"
+#include "core/RenderScale.h"
+#include "FrameBuffer.h"
+#include "FrameProfiler.h"
 #include "ParticleRenderer.h"
+#include "SoftwareRenderer.h"
+#include "core/ImageWriter.h"
 #include "Utils.h" // other includes are in Utils.h
 
 
@@ -24,9 +36,58 @@ const float zoom = 0.7f;
 // Toggle space partitioning
 bool useSpacePartitioning = true;
 
+// Broadphase used with space partitioning, Auto picks between the grid, the SIMD all
+// pairs kernel, sweep and prune and the spatial hash from the particle count and how
+// crowded the scene is
+const BroadphaseType broadphase = BroadphaseType::Auto;
+
+// Remove the walls, particles fly off forever. The grid needs bounds so the spatial
+// hash takes its place (the event-driven mode still bounces off the walls)
+const bool unboundedDomain = false;
+
+// Update the uniform grid by moving only the particles that changed cell instead of
+// rebuilding it every substep. Same results, cheaper when the scene is mostly at rest
+const bool incrementalGrid = false;
+
 // Number of substeps for simulation
 const unsigned int subSteps = 6;
 
+// Integration scheme and temperature model, each combination runs its own specialised kernel.
+// Temperature isn't drawn, leaving it off keeps its per-particle channel unallocated
+const IntegratorType integrator = IntegratorType::SemiImplicitEuler;
+const bool useTemperature = false;
+
+// Contact solver. Jacobi solves all pairs from the same state on every core and gives
+// the same result for any thread count, Gauss-Seidel converges faster on one core
+const SolverType solver = SolverType::GaussSeidel;
+
+// Bit-reproducible runs: contact pairs solved in a fixed order whatever the broadphase,
+// random numbers drawn from seed. The state checksum goes in the window title.
+// Sleeping is ignored while it's on
+const bool deterministic = false;
+const uint64_t seed = 1;
+
+// Adaptive timestep (CFL condition): substeps are chosen every frame so that no particle
+// moves more than cflDisplacement * radius per substep, subSteps is then ignored
+const bool useAdaptiveTimeStep = false;
+const float cflDisplacement = 0.5f;
+const int maxAdaptiveSubSteps = 32;
+
+// Use the event-driven hard-disc solver instead of fixed substeps. No gravity,
+// perfectly elastic collisions and exact energy conservation (thermodynamics runs)
+const bool useEventDriven = false;
+
+// Put settled regions to sleep (needs space partitioning). Particles slower than
+// sleepSpeed for sleepSteps substeps stop being integrated and pair-tested
+const bool useSleeping = false;
+const float sleepSpeed = 2.0f;
+const int sleepSteps = 60;
+
+// Sweep particles that move more than ccdThreshold * radius per substep against their
+// neighbours instead of letting them tunnel, with this on subSteps can drop to 1-2
+const bool useContinuousCollision = true;
+const float ccdThreshold = 0.5f;
+
 // Particle size (in simulation units)
 const float particleRadius = 6.0f;
 
@@ -52,6 +113,23 @@ const Vec2 initialVelocityStream0 = { 100.0, -100.0 };
 const Vec2 initialVelocityStream1 = { -100.0f, -100.0f };
 const Vec2 initialVelocityStream2 = { 100.0, -100.0 };
 
+// Radius of each stream's particles (0 = particleRadius). Different sizes store a radius
+// per particle and replace the grid and the hash with the hierarchical grid
+const float particleRadiusStream0 = 0.0f;
+const float particleRadiusStream1 = 0.0f;
+const float particleRadiusStream2 = 0.0f;
+
+// Random deviation (radians) of the spawn velocity, the same in every stream
+const float streamSpread = 0.0f;
+
+// --- RAIN ---
+
+// Line emitter along the top border and a kill zone along the bottom one, particles
+// are spawned and removed continuously (0 particles per second disables it)
+const float rainRate = 0.0f;
+const Vec2 rainVelocity = { 0.0f, -200.0f };
+const float rainKillHeight = 50.0f;
+
 // ---------  BORDER --------- 
 
 // Set border rendering parameters
@@ -59,8 +137,47 @@ glm::vec4 simBorderColor(1.0f, 1.0f, 1.0f, 0.5f); // White
 glm::vec4 gridBorderColor(0.0f, 1.0f, 0.0f, 0.5f); // Green
 float borderWidth = 2.0f;
 
+// ---------  RENDERING --------- 
+
+// Quads draws every particle as an instanced quad, Points as a single point sprite
+// (4 times fewer vertices, back to quads when the discs are too big for the driver)
+const ParticleDrawMode drawMode = ParticleDrawMode::Quads;
+
+// Draw the discs with hard edges and without blending, they overwrite each other. Cheaper
+// per pixel, for crowded scenes where they cover each other anyway
+const bool opaqueParticles = false;
+
+// Zoomed in, upload and draw only the particles in the grid cells overlapping the view
+const bool frustumCulling = true;
+
+// Once particles outnumber the pixels of the box on screen, draw their density and mean
+// speed summed on the CPU as one full screen image instead of a disc each. Switches back
+// when zooming in, the window title says when it's on
+const bool densityLod = true;
+
+// Fraction of the window resolution particles and borders are drawn at, in an offscreen
+// buffer stretched over the window. Software OpenGL costs about in proportion to the
+// pixels, 0.5 draws a quarter of them, but the stretch costs a full window pass there,
+// it only pays off once particles cover the window more than once
+const float renderScale = 1.0f;
+
+// Follow the frame time instead: the scale drops when frames take longer than
+// renderScaleTargetMs (down to renderScaleMin) and creeps back up once they don't.
+// Only the drawing scales, a smaller scale that doesn't make frames faster is undone
+const bool adaptiveRenderScale = false;
+const float renderScaleTargetMs = 1000.0f / 60.0f;
+const float renderScaleMin = 0.25f;
+
+// CPU and GPU time of physics, upload and draws in the window title. The GPU times come
+// from timer queries read a frame or two late, so the pipeline never waits for them
+const bool frameProfiler = true;
+
 // =======================================================================
 
+// Window dimensions, headless frames are rendered at the same size
+const unsigned int WINDOW_WIDTH = 1280;
+const unsigned int WINDOW_HEIGHT = 960;
+
 
 
 // Updates the window title with formatted performance metrics
@@ -104,8 +221,162 @@ void UpdateWindowTitle(GLFWwindow* window, const Time& timeManager, const std::s
 }
 
 
-int main(void)
+// Simulation rectangle centred on the origin, with the same ratio as the window for simplicity
+static Bounds GetSimulationBounds()
+{
+    const float aspectRatio = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
+    const float simHeight = simWidth / aspectRatio;
+
+    Bounds bounds;
+    bounds.bottomLeft = Vec2(-simWidth / 2, -simHeight / 2);
+    bounds.topRight = Vec2(simWidth / 2, simHeight / 2);
+    return bounds;
+}
+
+// Apply the parameters above and add the particle sources
+static void SetupSimulation(SimulationSystem& sim)
+{
+    sim.SetIntegrator(integrator);
+    sim.SetSolver(solver);
+    sim.SetDeterministic(deterministic);
+    sim.SetSeed(seed);
+    sim.SetBroadphase(broadphase);
+    sim.SetUnbounded(unboundedDomain);
+    sim.SetIncrementalGrid(incrementalGrid);
+    sim.SetTemperatureEnabled(useTemperature);
+    sim.SetSleeping(useSleeping, sleepSpeed, sleepSteps);
+    sim.SetContinuousCollision(useContinuousCollision, ccdThreshold);
+    sim.SetZoom(zoom);
+
+    // Add particle streams
+    sim.AddParticleStream(totalParticlesPerStream, StreamSpeed,
+        initialVelocityStream0, particleMassStream,
+        { 0.0, 0.0 }, particleRadiusStream0, streamSpread);
+
+    sim.AddParticleStream(totalParticlesPerStream, StreamSpeed,
+        initialVelocityStream1,
+        particleMassStream,
+        { 1996.0, 0.0 }, particleRadiusStream1, streamSpread);
+
+    sim.AddParticleStream(totalParticlesPerStream, StreamSpeed,
+        initialVelocityStream2,
+        particleMassStream,
+        { 1000.0, 0.0 }, particleRadiusStream2, streamSpread);
+
+    if (rainRate > 0.0f)
+    {
+        const Vec2 bottomLeft = sim.GetBounds().bottomLeft;
+        const Vec2 topRight = sim.GetBounds().topRight;
+        const float simHeight = topRight.y - bottomLeft.y;
+
+        Emitter rain;
+        rain.shape = EmitterShape::Line;
+        rain.position = { bottomLeft.x + particleRadius, topRight.y - particleRadius };
+        rain.end = { topRight.x - particleRadius, topRight.y - particleRadius };
+        rain.velocity = rainVelocity;
+        rain.rate = rainRate;
+        sim.AddEmitter(rain);
+
+        // Reaches far below the floor so nothing falls past it in unbounded runs
+        sim.AddKillZone({ bottomLeft.x - simWidth, bottomLeft.y - simHeight },
+            { topRight.x + simWidth, bottomLeft.y + rainKillHeight });
+    }
+}
+
+// Advance one fixed frame with the chosen scheme
+static void StepSimulation(SimulationSystem& sim, EventDrivenSolver& eventSolver, float frameTime)
+{
+    if (useEventDriven)
+    {
+        // Jump from event to event, no substeps needed
+        eventSolver.Advance(frameTime);
+        sim.UpdateStreams(frameTime);
+        sim.UpdateEmitters(frameTime);
+        return;
+    }
+
+    if (useAdaptiveTimeStep)
+    {
+        UpdatePhysicsAdaptive(sim, frameTime, cflDisplacement, maxAdaptiveSubSteps, useSpacePartitioning);
+        return;
+    }
+
+    for (unsigned int j = 0; j < subSteps; j++)
+        UpdatePhysics(sim, frameTime / subSteps, useSpacePartitioning);
+}
+
+// No window or GPU: run frameCount frames of 1/60 s, draw each with SoftwareRenderer
+// and write it to output_0000.png, output_0001.png... or, when output ends in .y4m,
+// append it to that video. Returns the exit code
+static int RenderHeadless(int frameCount, const std::string& output)
 {
+    const float frameTime = 1.0f / 60.0f;
+    const bool video = output.size() > 4 && output.compare(output.size() - 4, 4, ".y4m") == 0;
+
+    const Bounds simBounds = GetSimulationBounds();
+    SimulationSystem sim(simBounds.bottomLeft, simBounds.topRight, particleRadius, WINDOW_WIDTH);
+    SetupSimulation(sim);
+    EventDrivenSolver eventSolver(sim);
+    SoftwareRenderer renderer(WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    Y4mWriter videoWriter(video ? output : std::string(), WINDOW_WIDTH, WINDOW_HEIGHT, 60);
+    if (video && !videoWriter.IsOpen())
+    {
+        std::cerr << "Couldn't open " << output << std::endl;
+        return 1;
+    }
+
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        StepSimulation(sim, eventSolver, frameTime);
+        renderer.Render(sim);
+
+        bool written;
+        if (video)
+        {
+            written = videoWriter.WriteFrame(renderer.GetPixels());
+        }
+        else
+        {
+            char suffix[16];
+            snprintf(suffix, sizeof(suffix), "_%04d.png", frame);
+            written = WritePng(output + suffix, WINDOW_WIDTH, WINDOW_HEIGHT, renderer.GetPixels());
+        }
+
+        if (!written)
+        {
+            std::cerr << "Couldn't write frame " << frame << " to " << output << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Rendered " << frameCount << " frames of " << sim.GetParticles().size() << " particles to "
+        << output << (video ? "" : "_*.png") << std::endl;
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    // Headless benchmarks, no window needed
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--bench-broadphase")
+            return RunBroadphaseBenchmark();
+        if (std::string(argv[i]) == "--bench-scaling")
+            return RunScalingBenchmark(i + 1 < argc && argv[i + 1][0] != '-' ? argv[i + 1] : "scaling");
+        if (std::string(argv[i]) == "--bench-counters")
+            return RunCounterBenchmark();
+        if (std::string(argv[i]) == "--bench-splat")
+            return RunSplatBenchmark();
+        if (std::string(argv[i]) == "--bench-draw")
+            return RunDrawBenchmark();
+        if (std::string(argv[i]) == "--bench-alloc")
+            return RunAllocationBenchmark();
+        if (std::string(argv[i]) == "--render" && i + 1 < argc)
+            return RenderHeadless(std::atoi(argv[i + 1]), i + 2 < argc && argv[i + 2][0] != '-' ? argv[i + 2] : "frame");
+    }
+
     // Initialize GLFW
     if (!glfwInit())
     {
@@ -118,10 +389,6 @@ int main(void)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    // Window dimensions
-    const unsigned int WINDOW_WIDTH = 1280;
-    const unsigned int WINDOW_HEIGHT = 960;
-
     // Create a windowed mode window and its OpenGL context
     GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Particle Simulation", nullptr, nullptr);
     if (!window)
@@ -151,37 +418,11 @@ int main(void)
     GLCall(glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT));
 
     { // Additional scope to avoid memory leaks
-      
-      // Set up simulation boundaries based on screen coordinates
-        // Use normalized device coordinates for simplicity, then scale with view matrix
-        const float aspectRatio = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
-
-        // Make simulation rectangle the same ratio of the screen for simplicity
-        const float simHeight = simWidth / aspectRatio;
-
-        // Define simulation boundaries centered on the origin
-        Vec2 bottomLeft(-simWidth / 2, -simHeight / 2);
-        Vec2 topRight(simWidth / 2, simHeight / 2);
 
         // Create simulation system
-        SimulationSystem sim(bottomLeft, topRight, particleRadius, WINDOW_WIDTH);
-       
-        // Add particle streams
-        sim.AddParticleStream(totalParticlesPerStream, StreamSpeed,
-            initialVelocityStream0, particleMassStream,
-            { 0.0, 0.0 });
-
-        
-
-        sim.AddParticleStream(totalParticlesPerStream, StreamSpeed,
-            initialVelocityStream1,
-            particleMassStream,
-            { 1996.0, 0.0 });
-
-        sim.AddParticleStream(totalParticlesPerStream, StreamSpeed,
-            initialVelocityStream2,
-            particleMassStream,
-            { 1000.0, 0.0 });
+        const Bounds simBounds = GetSimulationBounds();
+        SimulationSystem sim(simBounds.bottomLeft, simBounds.topRight, particleRadius, WINDOW_WIDTH);
+        SetupSimulation(sim);
 
         // Enable blending
         GLCall(glEnable(GL_BLEND));
@@ -202,53 +443,157 @@ int main(void)
 
         // initialize particle renderer
         ParticleRenderer renderer(sim, shader);
+        renderer.SetDrawMode(drawMode);
+        renderer.SetOpaque(opaqueParticles);
+        renderer.SetCulling(frustumCulling);
+        renderer.SetDensityLod(densityLod);
 
         // Create time manager
         Time timeManager(1.0f / 60.0f);
 
+        // Event-driven solver, only used when useEventDriven is set
+        EventDrivenSolver eventSolver(sim);
+
+        // Offscreen target for render scales under 1
+        FrameBuffer sceneBuffer;
+        RenderScale renderScaleController(renderScaleTargetMs, renderScaleMin, renderScale);
+
+        FrameProfiler profiler;
+        profiler.SetEnabled(frameProfiler);
+
         // Initialize counter for fps 
         int counter = 0;
 
         // Main loop
         while (!glfwWindowShouldClose(window))
         {
+            profiler.BeginFrame();
+
+            // Draw into the smaller buffer, the window gets it at the end of the frame
+            const float scale = adaptiveRenderScale ? renderScaleController.GetScale() : renderScale;
+            const bool scaled = scale < 1.0f;
+            if (scaled)
+            {
+                sceneBuffer.Resize(static_cast<int>(WINDOW_WIDTH * scale + 0.5f), static_cast<int>(WINDOW_HEIGHT * scale + 0.5f));
+                sceneBuffer.Bind();
+            }
+
             // Clear the screen
             GLCall(glClear(GL_COLOR_BUFFER_BIT));
             GLCall(glClearColor(0.0f, 0.0f, 0.0f, 1.0f));  // Black background
 
-            // Set zoom for simulation
-            sim.SetZoom(zoom);
-
             // Setup border mvp, this in the future will be inside 
             // particle renderer of sim system (maybe)
             glm::mat4 borderMVP = sim.GetProjMatrix() * sim.GetViewMatrix();
 
             // Update physics before rendering
+            profiler.Begin(FramePhase::Physics);
             int steps = timeManager.update();
             for (int i = 0; i < steps; i++)
-            {
-                for (int j = 0; j < subSteps; j++)
-                {
-                    UpdatePhysics(sim, timeManager.getFixedDeltaTime() / subSteps, useSpacePartitioning);
-                }
-            }
+                StepSimulation(sim, eventSolver, timeManager.getFixedDeltaTime());
+            profiler.End(FramePhase::Physics);
 
             // Update buffers with new particle data
+            profiler.Begin(FramePhase::Upload);
             renderer.UpdateBuffers();
+            profiler.End(FramePhase::Upload);
 
             // Render the particles 
+            profiler.Begin(FramePhase::Particles);
             renderer.Render();
+            profiler.End(FramePhase::Particles);
 
             // Render simulation borders
             // This implementation isn't the best but good enough
             const auto& bounds = sim.GetBounds();
 
-            BoundsRenderer(bounds.bottomLeft, bounds.topRight, borderWidth, simBorderColor, borderMVP);
+            // Scaled down, at least a pixel of the buffer wide or the border falls between pixels
+            float drawnBorderWidth = borderWidth;
+            if (scaled)
+            {
+                const float pixelWidth = 2.0f / (glm::abs(borderMVP[0][0]) * sceneBuffer.GetWidth());
+                drawnBorderWidth = borderWidth > pixelWidth ? borderWidth : pixelWidth;
+            }
+
+            profiler.Begin(FramePhase::Borders);
+            BoundsRenderer(bounds.bottomLeft, bounds.topRight, drawnBorderWidth, simBorderColor, borderMVP);
+            profiler.End(FramePhase::Borders);
+
+            // Upscale over the whole window
+            if (scaled)
+            {
+                profiler.Begin(FramePhase::Upscale);
+                sceneBuffer.BlitToScreen(WINDOW_WIDTH, WINDOW_HEIGHT);
+                profiler.End(FramePhase::Upscale);
+            }
+            profiler.EndFrame();
 
             // Display fps and mspf
             if (++counter > 75)
             {
-                UpdateWindowTitle(window, timeManager);
+                // Two replays can be compared at a glance
+                std::string appName = "Particle Simulation";
+                if (deterministic)
+                {
+                    char checksumBuffer[32];
+                    snprintf(checksumBuffer, sizeof(checksumBuffer), " | State %016llx",
+                        static_cast<unsigned long long>(sim.ComputeStateChecksum()));
+                    appName += checksumBuffer;
+                }
+                if (incrementalGrid)
+                {
+                    char movedBuffer[32];
+                    snprintf(movedBuffer, sizeof(movedBuffer), " | Grid moved %4.1f%%",
+                        100.0f * sim.GetGridMovedFraction());
+                    appName += movedBuffer;
+                }
+                if (renderer.IsDensityLodActive())
+                {
+                    char lodBuffer[48];
+                    snprintf(lodBuffer, sizeof(lodBuffer), " | Density LOD (%.2f particles/px)",
+                        renderer.GetParticlesPerPixel());
+                    appName += lodBuffer;
+                }
+                if (scaled || adaptiveRenderScale)
+                {
+                    char scaleBuffer[48];
+                    snprintf(scaleBuffer, sizeof(scaleBuffer), " | Scale %.2f (%dx%d)", scale,
+                        scaled ? sceneBuffer.GetWidth() : static_cast<int>(WINDOW_WIDTH),
+                        scaled ? sceneBuffer.GetHeight() : static_cast<int>(WINDOW_HEIGHT));
+                    appName += scaleBuffer;
+                }
+                if (profiler.IsEnabled())
+                {
+                    // CPU/GPU per phase, the GPU side is "-" until the first results are back
+                    appName += " | CPU/GPU ms:";
+                    for (int i = 0; i < static_cast<int>(FramePhase::Count); i++)
+                    {
+                        const FramePhase phase = static_cast<FramePhase>(i);
+                        if (phase == FramePhase::Upscale && !scaled)
+                            continue;
+
+                        char phaseBuffer[48];
+                        if (phase == FramePhase::Physics)
+                            snprintf(phaseBuffer, sizeof(phaseBuffer), " %s %.2f", GetFramePhaseName(phase), profiler.GetCpuMs(phase));
+                        else if (profiler.HasGpuTimes())
+                            snprintf(phaseBuffer, sizeof(phaseBuffer), " %s %.2f/%.2f", GetFramePhaseName(phase), profiler.GetCpuMs(phase), profiler.GetGpuMs(phase));
+                        else
+                            snprintf(phaseBuffer, sizeof(phaseBuffer), " %s %.2f/-", GetFramePhaseName(phase), profiler.GetCpuMs(phase));
+                        appName += phaseBuffer;
+                    }
+
+                    // Pixels written by the particle draw over the pixels drawn on
+                    const double drawnPixels = scaled ?
+                        static_cast<double>(sceneBuffer.GetWidth()) * sceneBuffer.GetHeight() :
+                        static_cast<double>(WINDOW_WIDTH) * WINDOW_HEIGHT;
+                    char overdrawBuffer[32];
+                    snprintf(overdrawBuffer, sizeof(overdrawBuffer), " | Overdraw %.2f",
+                        profiler.GetSamplesPassed(FramePhase::Particles) / drawnPixels);
+                    appName += overdrawBuffer;
+                    profiler.ResetAverages();
+                }
+
+                UpdateWindowTitle(window, timeManager, appName);
                 counter = 0;
             }
 
@@ -257,6 +602,10 @@ int main(void)
 
             // Poll for and process events
             glfwPollEvents();
+
+            // The last frame time (measured when this frame started) decides the size of the next ones
+            if (adaptiveRenderScale)
+                renderScaleController.Update(timeManager.getLastFrameTimeMs());
         }
     }
 
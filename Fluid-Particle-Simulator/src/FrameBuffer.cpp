@@ -0,0 +1,64 @@
+#include "FrameBuffer.h"
+#include "Renderer.h"
+#include <iostream>
+
+FrameBuffer::FrameBuffer()
+    : m_RendererID(0), m_ColorTexture(0), m_Width(0), m_Height(0)
+{
+    GLCall(glGenFramebuffers(1, &m_RendererID));
+
+    // Linear so a scaled blit reads it smoothly, no mipmaps
+    GLCall(glGenTextures(1, &m_ColorTexture));
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_ColorTexture));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+FrameBuffer::~FrameBuffer()
+{
+    GLCall(glDeleteFramebuffers(1, &m_RendererID));
+    GLCall(glDeleteTextures(1, &m_ColorTexture));
+}
+
+void FrameBuffer::Resize(int width, int height)
+{
+    if (width == m_Width && height == m_Height)
+        return;
+
+    m_Width = width;
+    m_Height = height;
+
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_ColorTexture));
+    GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_RendererID));
+    GLCall(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ColorTexture, 0));
+    GLCall(GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Warning: framebuffer " << width << "x" << height << " incomplete (" << status << ")" << std::endl;
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+void FrameBuffer::Bind() const
+{
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_RendererID));
+    GLCall(glViewport(0, 0, m_Width, m_Height));
+}
+
+void FrameBuffer::UnBind() const
+{
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+void FrameBuffer::BlitToScreen(int screenWidth, int screenHeight) const
+{
+    GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_RendererID));
+    GLCall(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+    GLCall(glBlitFramebuffer(0, 0, m_Width, m_Height, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR));
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    GLCall(glViewport(0, 0, screenWidth, screenHeight));
+}
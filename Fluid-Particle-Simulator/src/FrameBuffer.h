@@ -0,0 +1,27 @@
+#pragma once
+
+// Offscreen colour target, drawn into instead of the window and then stretched over it.
+// Storage is only reallocated when the size changes
+class FrameBuffer
+{
+private:
+    unsigned int m_RendererID;
+    unsigned int m_ColorTexture;  // RGBA8, what gets blitted
+    int m_Width;
+    int m_Height;
+public:
+    FrameBuffer();
+    ~FrameBuffer();
+
+    void Resize(int width, int height);
+
+    // Bind also sets the viewport to the whole buffer
+    void Bind() const;
+    void UnBind() const;
+
+    // Bilinear upscale over the window (the default framebuffer), leaves it bound
+    void BlitToScreen(int screenWidth, int screenHeight) const;
+
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+};
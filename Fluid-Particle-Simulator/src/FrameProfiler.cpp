@@ -0,0 +1,174 @@
+#include "FrameProfiler.h"
+#include "Renderer.h"
+
+const char* GetFramePhaseName(FramePhase phase)
+{
+    switch (phase)
+    {
+    case FramePhase::Physics: return "physics";
+    case FramePhase::Upload: return "upload";
+    case FramePhase::Particles: return "particles";
+    case FramePhase::Borders: return "borders";
+    case FramePhase::Upscale: return "upscale";
+    default: return "?";
+    }
+}
+
+// Physics doesn't touch GL, a timer around it would only measure nothing
+static bool HasGpuWork(int phase)
+{
+    return phase != static_cast<int>(FramePhase::Physics);
+}
+
+FrameProfiler::FrameProfiler()
+    : m_Current(0), m_Enabled(true)
+{
+    for (FrameQueries& frame : m_Frames)
+    {
+        GLCall(glGenQueries(PHASE_COUNT, frame.timers));
+        GLCall(glGenQueries(PHASE_COUNT, frame.samples));
+        for (bool& issued : frame.issued)
+            issued = false;
+        frame.pending = false;
+    }
+    ResetAverages();
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    for (FrameQueries& frame : m_Frames)
+    {
+        GLCall(glDeleteQueries(PHASE_COUNT, frame.timers));
+        GLCall(glDeleteQueries(PHASE_COUNT, frame.samples));
+    }
+}
+
+bool FrameProfiler::IsAvailable(const FrameQueries& frame) const
+{
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+    {
+        if (!frame.issued[phase])
+            continue;
+
+        GLuint timerAvailable = GL_FALSE;
+        GLuint samplesAvailable = GL_FALSE;
+        GLCall(glGetQueryObjectuiv(frame.timers[phase], GL_QUERY_RESULT_AVAILABLE, &timerAvailable));
+        GLCall(glGetQueryObjectuiv(frame.samples[phase], GL_QUERY_RESULT_AVAILABLE, &samplesAvailable));
+        if (!timerAvailable || !samplesAvailable)
+            return false;
+    }
+    return true;
+}
+
+void FrameProfiler::Read(FrameQueries& frame)
+{
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+    {
+        if (!frame.issued[phase])
+            continue;
+
+        GLuint64 nanoseconds = 0;
+        GLuint64 samples = 0;
+        GLCall(glGetQueryObjectui64v(frame.timers[phase], GL_QUERY_RESULT, &nanoseconds));
+        GLCall(glGetQueryObjectui64v(frame.samples[phase], GL_QUERY_RESULT, &samples));
+        m_GpuMs[phase] += nanoseconds * 1e-6;
+        m_Samples[phase] += static_cast<double>(samples);
+        m_GpuPhaseFrames[phase]++;
+    }
+    m_GpuFrames++;
+    frame.pending = false;
+}
+
+void FrameProfiler::BeginFrame()
+{
+    if (!m_Enabled)
+        return;
+
+    // Oldest first, the GPU finishes frames in order so the first one not done ends it
+    for (int i = 1; i < FRAME_PROFILER_FRAMES; i++)
+    {
+        FrameQueries& frame = m_Frames[(m_Current + i) % FRAME_PROFILER_FRAMES];
+        if (!frame.pending)
+            continue;
+        if (!IsAvailable(frame))
+            break;
+        Read(frame);
+    }
+
+    // Still not done after a whole ring, too far behind, its queries get reused
+    m_Current = (m_Current + 1) % FRAME_PROFILER_FRAMES;
+    FrameQueries& frame = m_Frames[m_Current];
+    frame.pending = false;
+    for (bool& issued : frame.issued)
+        issued = false;
+}
+
+void FrameProfiler::EndFrame()
+{
+    if (!m_Enabled)
+        return;
+
+    m_Frames[m_Current].pending = true;
+}
+
+void FrameProfiler::Begin(FramePhase phase)
+{
+    if (!m_Enabled)
+        return;
+
+    const int index = static_cast<int>(phase);
+    if (HasGpuWork(index))
+    {
+        FrameQueries& frame = m_Frames[m_Current];
+        GLCall(glBeginQuery(GL_TIME_ELAPSED, frame.timers[index]));
+        GLCall(glBeginQuery(GL_SAMPLES_PASSED, frame.samples[index]));
+        frame.issued[index] = true;
+    }
+    m_PhaseStart = Clock::now();
+}
+
+void FrameProfiler::End(FramePhase phase)
+{
+    if (!m_Enabled)
+        return;
+
+    const int index = static_cast<int>(phase);
+    m_CpuMs[index] += std::chrono::duration<double, std::milli>(Clock::now() - m_PhaseStart).count();
+    m_CpuPhaseFrames[index]++;
+    if (HasGpuWork(index))
+    {
+        GLCall(glEndQuery(GL_SAMPLES_PASSED));
+        GLCall(glEndQuery(GL_TIME_ELAPSED));
+    }
+}
+
+float FrameProfiler::GetCpuMs(FramePhase phase) const
+{
+    const int index = static_cast<int>(phase);
+    return m_CpuPhaseFrames[index] > 0 ? static_cast<float>(m_CpuMs[index] / m_CpuPhaseFrames[index]) : 0.0f;
+}
+
+float FrameProfiler::GetGpuMs(FramePhase phase) const
+{
+    const int index = static_cast<int>(phase);
+    return m_GpuPhaseFrames[index] > 0 ? static_cast<float>(m_GpuMs[index] / m_GpuPhaseFrames[index]) : 0.0f;
+}
+
+double FrameProfiler::GetSamplesPassed(FramePhase phase) const
+{
+    const int index = static_cast<int>(phase);
+    return m_GpuPhaseFrames[index] > 0 ? m_Samples[index] / m_GpuPhaseFrames[index] : 0.0;
+}
+
+void FrameProfiler::ResetAverages()
+{
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+    {
+        m_CpuMs[phase] = 0.0;
+        m_GpuMs[phase] = 0.0;
+        m_Samples[phase] = 0.0;
+        m_CpuPhaseFrames[phase] = 0;
+        m_GpuPhaseFrames[phase] = 0;
+    }
+    m_GpuFrames = 0;
+}
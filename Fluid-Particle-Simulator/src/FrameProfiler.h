@@ -0,0 +1,81 @@
+#pragma once
+#include <chrono>
+
+// Parts of a frame of the main loop, in the order it runs them
+enum class FramePhase {
+    Physics,    // simulation steps, no GL work
+    Upload,     // ParticleRenderer::UpdateBuffers, culling or density summing included
+    Particles,  // ParticleRenderer::Render
+    Borders,    // BoundsRenderer
+    Upscale,    // FrameBuffer::BlitToScreen, only at render scales under 1
+    Count
+};
+
+const char* GetFramePhaseName(FramePhase phase);
+
+// Frames of queries in flight. Results are read once the GPU has them, usually one or
+// two frames later. A frame still not done when its slot comes back is dropped
+const int FRAME_PROFILER_FRAMES = 4;
+
+// CPU and GPU time of every phase of the frame, averaged until ResetAverages.
+// GL calls only queue the work, so the CPU time of a draw is its submission and the
+// GPU time comes from GL_TIME_ELAPSED queries around the same calls. A GL_SAMPLES_PASSED
+// query next to each one counts the pixels it wrote. Nothing ever waits on a result
+class FrameProfiler
+{
+private:
+    typedef std::chrono::high_resolution_clock Clock;
+    static const int PHASE_COUNT = static_cast<int>(FramePhase::Count);
+
+    struct FrameQueries {
+        unsigned int timers[PHASE_COUNT];
+        unsigned int samples[PHASE_COUNT];
+        bool issued[PHASE_COUNT];  // begun this frame, the others have no result
+        bool pending;
+    };
+
+    FrameQueries m_Frames[FRAME_PROFILER_FRAMES];
+    int m_Current;  // slot of the frame being recorded
+    bool m_Enabled;
+    Clock::time_point m_PhaseStart;
+
+    double m_CpuMs[PHASE_COUNT];
+    double m_GpuMs[PHASE_COUNT];
+    double m_Samples[PHASE_COUNT];
+
+    // Frames each phase ran in (upscale only runs on scaled frames) and was read back in,
+    // the averages are over those
+    int m_CpuPhaseFrames[PHASE_COUNT];
+    int m_GpuPhaseFrames[PHASE_COUNT];
+    int m_GpuFrames;  // frames read back
+
+    bool IsAvailable(const FrameQueries& frame) const;
+    void Read(FrameQueries& frame);
+
+public:
+    FrameProfiler();
+    ~FrameProfiler();
+
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    // Off, every call below returns at once
+    void SetEnabled(bool enabled) { m_Enabled = enabled; }
+    bool IsEnabled() const { return m_Enabled; }
+
+    // Reads the finished frames and starts recording a new one
+    void BeginFrame();
+    void EndFrame();
+
+    // Phases don't nest, a GPU timer can't run inside another
+    void Begin(FramePhase phase);
+    void End(FramePhase phase);
+
+    // Per frame the phase ran in, 0 before it was measured
+    float GetCpuMs(FramePhase phase) const;
+    float GetGpuMs(FramePhase phase) const;
+    double GetSamplesPassed(FramePhase phase) const;
+    bool HasGpuTimes() const { return m_GpuFrames > 0; }
+
+    void ResetAverages();
+};
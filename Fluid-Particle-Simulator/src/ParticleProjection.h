@@ -0,0 +1,40 @@
+#pragma once
+
+#include "physics/SimulationSystem.h"
+#include "core/ThreadPool.h"
+#include <cmath>
+
+// Projecting is cheap, don't wake the pool for a handful of particles
+const int PROJECTION_MIN_CHUNK = 4096;
+
+// Take every particle through GetProjMatrix() * GetViewMatrix() to a width x height
+// frame and call func(i, x, y, radiusX, radiusY) on the thread pool, with the centre
+// in pixels from the bottom left corner (y up) and the radius in pixels along each
+// axis. The projection is orthographic, clip space is NDC and a radius scales the
+// same everywhere
+template <class Function>
+void ForEachProjectedParticle(const SimulationSystem& simulation, int width, int height, const Function& func)
+{
+    const std::vector<Particle>& particles = simulation.GetParticles();
+    const glm::mat4 mvp = simulation.GetProjMatrix() * simulation.GetViewMatrix();
+    const float halfWidth = 0.5f * width;
+    const float halfHeight = 0.5f * height;
+    const float pixelsPerUnitX = std::abs(mvp[0][0]) * halfWidth;
+    const float pixelsPerUnitY = std::abs(mvp[1][1]) * halfHeight;
+
+    const float particleRadius = simulation.GetParticleRadius();
+    const ParticleAttributes& attributes = simulation.GetAttributes();
+    const float* radii = attributes.Has(ParticleChannel::Radius) ? attributes.GetRadius().data() : nullptr;
+
+    ThreadPool::Get().ParallelFor(0, static_cast<int>(particles.size()), [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            const Vec2& position = particles[i].position;
+            const float x = (mvp[0][0] * position.x + mvp[1][0] * position.y + mvp[3][0] + 1.0f) * halfWidth;
+            const float y = (mvp[0][1] * position.x + mvp[1][1] * position.y + mvp[3][1] + 1.0f) * halfHeight;
+            const float size = radii ? radii[i] : particleRadius;
+            func(i, x, y, size * pixelsPerUnitX, size * pixelsPerUnitY);
+        }
+    }, PROJECTION_MIN_CHUNK);
+}
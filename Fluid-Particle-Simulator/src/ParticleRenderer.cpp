@@ -1,14 +1,71 @@
 #include "ParticleRenderer.h"
 #include "Renderer.h"
 #include "VertexBufferLayout.h"
+#include "Utils.h"
+#include "ParticleProjection.h"
+#include "core/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
+// Particles per pixel of the simulation box on screen above which the density image
+// replaces the discs, and below which the discs come back. Apart so zooming around
+// the threshold doesn't flicker between the two
+const float DENSITY_LOD_ENTER = 0.5f;
+const float DENSITY_LOD_EXIT = 0.25f;
+
+// Every band of rows goes through all the samples, don't cut the screen too thin
+const int DENSITY_MIN_ROWS = 64;
+
+const float DENSITY_PI = 3.14159265f;
+
+// Culling splits the rows of visible cells between threads, and the particles spawned
+// since the grid was filled (tested one by one)
+const int CULL_MIN_ROWS = 8;
+const int CULL_MIN_CHUNK = 4096;
+
+static inline void FillInstance(ParticleInstance& instance, const Particle& particle, float size)
+{
+    instance.position = particle.position;
+    instance.velocity = particle.velocity;
+    instance.size = size;
+}
+
 ParticleRenderer::ParticleRenderer(const SimulationSystem& simulation, const Shader& shader)
     : m_Simulation(simulation), m_Shader(shader), m_VertexArray(nullptr),
-    m_VertexBuffer(nullptr), m_InstanceBuffer(nullptr), m_IndexBuffer(nullptr)
+    m_VertexBuffer(nullptr), m_InstanceBuffer(nullptr), m_IndexBuffer(nullptr),
+    m_InstanceCount(0), m_ViewportWidth(0),
+    m_DrawMode(ParticleDrawMode::Quads), m_PointShader(nullptr), m_PointArray(nullptr), m_MaxPointSize(1.0f),
+    m_Opaque(false),
+    m_CullingEnabled(true),
+    m_DensityShader(nullptr), m_ScreenArray(nullptr), m_DensityTexture(0),
+    m_DensityWidth(0), m_DensityHeight(0),
+    m_DensityLodEnabled(true), m_DensityLodActive(false), m_ParticlesPerPixel(0.0f)
 {
     // Initialize buffers
     InitBuffers();
+
+    // Largest point the driver draws, bigger discs go back to quads
+    std::string pointShaderPath = "res/shaders/ParticlePointShader.shader";
+    if (IsShaderPathOk(pointShaderPath))
+        m_PointShader = new Shader(pointShaderPath);
+    float pointSizeRange[2] = { 1.0f, 1.0f };
+    GLCall(glGetFloatv(GL_POINT_SIZE_RANGE, pointSizeRange));
+    m_MaxPointSize = pointSizeRange[1];
+
+    // Without its shader the density LOD stays off and every particle is drawn
+    std::string densityShaderPath = "res/shaders/DensityShader.shader";
+    if (IsShaderPathOk(densityShaderPath))
+        m_DensityShader = new Shader(densityShaderPath);
+
+    // Nearest, a texel is exactly a pixel
+    GLCall(glGenTextures(1, &m_DensityTexture));
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_DensityTexture));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GLCall(glBindTexture(GL_TEXTURE_2D, 0));
 }
 
 ParticleRenderer::~ParticleRenderer()
@@ -33,6 +90,28 @@ ParticleRenderer::~ParticleRenderer()
         delete m_VertexArray;
         m_VertexArray = nullptr;
     }
+
+    if (m_ScreenArray) {
+        delete m_ScreenArray;
+        m_ScreenArray = nullptr;
+    }
+
+    if (m_PointArray) {
+        delete m_PointArray;
+        m_PointArray = nullptr;
+    }
+
+    if (m_PointShader) {
+        delete m_PointShader;
+        m_PointShader = nullptr;
+    }
+
+    if (m_DensityShader) {
+        delete m_DensityShader;
+        m_DensityShader = nullptr;
+    }
+
+    GLCall(glDeleteTextures(1, &m_DensityTexture));
 }
 
 void ParticleRenderer::InitBuffers()
@@ -74,6 +153,12 @@ void ParticleRenderer::InitBuffers()
     m_VertexArray->Bind();
     m_IndexBuffer->Bind();
 
+    // The density pass draws the same quad, without instances, over the whole screen
+    m_ScreenArray = new VertexArray();
+    m_ScreenArray->AddBuffer(*m_VertexBuffer, quadLayout);
+    m_ScreenArray->Bind();
+    m_IndexBuffer->Bind();
+
     // Allocate based on current particle count
     const size_t initialBufferSize = sizeof(ParticleInstance) * m_Simulation.GetParticles().size();
     m_InstanceBuffer = new VertexBuffer(nullptr, initialBufferSize, GL_STREAM_DRAW);
@@ -102,6 +187,18 @@ void ParticleRenderer::InitBuffers()
     GLCall(glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)(4 * sizeof(float))));
     GLCall(glVertexAttribDivisor(4, 1)); // Size (advance one instance at a time)
 
+    // Point sprites read the same buffer, one vertex per particle
+    m_PointArray = new VertexArray();
+    m_PointArray->Bind();
+    m_InstanceBuffer->Bind();
+    GLCall(glEnableVertexAttribArray(2));
+    GLCall(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)0));
+    GLCall(glEnableVertexAttribArray(3));
+    GLCall(glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)(2 * sizeof(float))));
+    GLCall(glEnableVertexAttribArray(4));
+    GLCall(glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)(4 * sizeof(float))));
+    m_PointArray->UnBind();
+
     // Unbind everything
     m_VertexArray->UnBind();
     m_VertexBuffer->UnBind();
@@ -120,24 +217,40 @@ void ParticleRenderer::UpdateBuffers()
         return;
     }
 
+    // Pick the path first, the density image doesn't need the instance buffer
+    GLint viewport[4];
+    GLCall(glGetIntegerv(GL_VIEWPORT, viewport));
+    m_ViewportWidth = viewport[2];
+    UpdateDensityLod(viewport[2], viewport[3]);
+    if (m_DensityLodActive) {
+        UpdateDensityTexture(viewport[2], viewport[3]);
+        return;
+    }
+
     // Resize only if needed, preserving capacity
     if (m_InstanceData.size() < particleCount) {
         m_InstanceData.resize(particleCount);
     }
 
-    // Update instance data with particle positions and velocities
-    float particleRadius = m_Simulation.GetParticleRadius();
-    for (size_t i = 0; i < particleCount; i++) {
-        const Particle& particle = particles[i];
-        m_InstanceData[i].position = particle.position;
-        m_InstanceData[i].velocity = particle.velocity;
-        m_InstanceData[i].size = particleRadius;
+    // Update instance data with particle positions and velocities, sizes come from
+    // the radius channel when particles differ. Only the ones on screen when zoomed in
+    m_InstanceCount = m_CullingEnabled ? CullParticles() : -1;
+    if (m_InstanceCount < 0) {
+        float particleRadius = m_Simulation.GetParticleRadius();
+        const ParticleAttributes& attributes = m_Simulation.GetAttributes();
+        const float* radii = attributes.Has(ParticleChannel::Radius) ? attributes.GetRadius().data() : nullptr;
+        for (size_t i = 0; i < particleCount; i++)
+            FillInstance(m_InstanceData[i], particles[i], radii ? radii[i] : particleRadius);
+        m_InstanceCount = static_cast<int>(particleCount);
     }
 
+    if (m_InstanceCount == 0) {
+        return;
+    }
 
     // Update buffer
     m_InstanceBuffer->Bind();
-    size_t dataSize = sizeof(ParticleInstance) * particleCount;
+    size_t dataSize = sizeof(ParticleInstance) * m_InstanceCount;
 
     // Only reallocate if buffer is too small
     if (dataSize > m_InstanceBuffer->GetSize()) {
@@ -158,28 +271,334 @@ void ParticleRenderer::Render()
     if (m_Simulation.GetParticles().empty())
         return;
 
+    if (m_DensityLodActive) {
+        RenderDensity();
+        return;
+    }
+
+    // Everything culled
+    if (m_InstanceCount == 0)
+        return;
+
     // Create MVP for particles
     glm::mat4 particleMVP = m_Simulation.GetProjMatrix() * m_Simulation.GetViewMatrix();
 
     // Bind shader and set uniforms
-    m_Shader.Bind();
-    m_Shader.setUniformMat4f("u_MVP", particleMVP);
+    const bool points = IsDrawingPoints();
+    const Shader& shader = points ? *m_PointShader : m_Shader;
+    shader.Bind();
+    shader.setUniformMat4f("u_MVP", particleMVP);
+    shader.setUniform1i("u_Opaque", m_Opaque ? 1 : 0);
+
+    // Opaque discs overwrite whatever is under them
+    GLCall(const GLboolean blending = glIsEnabled(GL_BLEND));
+    if (m_Opaque && blending) {
+        GLCall(glDisable(GL_BLEND));
+    }
 
-    // Bind vertex array and index buffer
-    m_VertexArray->Bind();
-    m_IndexBuffer->Bind();
+    if (points) {
+        shader.setUniform1f("u_PixelsPerUnit", GetPixelsPerUnit());
 
-    // Draw instanced quads
-    GLCall(glDrawElementsInstanced(
-        GL_TRIANGLES,
-        6,                                                       // 6 indices per quad (2 triangles)
-        GL_UNSIGNED_INT,
-        0,
-        static_cast<GLsizei>(m_Simulation.GetParticles().size()) // Number of instances
-    ));
+        // One vertex per particle, sized by the shader
+        GLCall(glEnable(GL_PROGRAM_POINT_SIZE));
+        m_PointArray->Bind();
+        GLCall(glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(m_InstanceCount)));
+        m_PointArray->UnBind();
+        GLCall(glDisable(GL_PROGRAM_POINT_SIZE));
+    }
+    else {
+        // Bind vertex array and index buffer
+        m_VertexArray->Bind();
+        m_IndexBuffer->Bind();
+
+        // Draw instanced quads
+        GLCall(glDrawElementsInstanced(
+            GL_TRIANGLES,
+            6,                                                       // 6 indices per quad (2 triangles)
+            GL_UNSIGNED_INT,
+            0,
+            static_cast<GLsizei>(m_InstanceCount)                    // Number of instances
+        ));
+
+        m_VertexArray->UnBind();
+        m_IndexBuffer->UnBind();
+    }
 
     // Unbind everything
-    m_VertexArray->UnBind();
+    if (m_Opaque && blending) {
+        GLCall(glEnable(GL_BLEND));
+    }
+    shader.UnBind();
+}
+
+// Horizontal scale of the view, point sprites are square so the vertical one is ignored
+float ParticleRenderer::GetPixelsPerUnit() const
+{
+    const glm::mat4 mvp = m_Simulation.GetProjMatrix() * m_Simulation.GetViewMatrix();
+    return std::abs(mvp[0][0]) * 0.5f * m_ViewportWidth;
+}
+
+bool ParticleRenderer::IsDrawingPoints() const
+{
+    if (m_DrawMode != ParticleDrawMode::Points || !m_PointShader)
+        return false;
+    return 2.0f * m_Simulation.GetMaxParticleRadius() * GetPixelsPerUnit() <= m_MaxPointSize;
+}
+
+// Fill the instance data with the particles that can be on screen, returns how many or
+// -1 when the whole box is in view and there's nothing to cull
+int ParticleRenderer::CullParticles()
+{
+    const int count = static_cast<int>(m_Simulation.GetParticles().size());
+
+    // Visible rectangle in world units. The projection is orthographic without rotation,
+    // so the NDC edges map back through the diagonal of the MVP. Grown by the largest
+    // radius for the discs poking in from outside
+    const glm::mat4 mvp = m_Simulation.GetProjMatrix() * m_Simulation.GetViewMatrix();
+    const float margin = m_Simulation.GetMaxParticleRadius();
+    const float left = (-1.0f - mvp[3][0]) / mvp[0][0];
+    const float right = (1.0f - mvp[3][0]) / mvp[0][0];
+    const float bottom = (-1.0f - mvp[3][1]) / mvp[1][1];
+    const float top = (1.0f - mvp[3][1]) / mvp[1][1];
+    const Vec2 viewMin(std::min(left, right) - margin, std::min(bottom, top) - margin);
+    const Vec2 viewMax(std::max(left, right) + margin, std::max(bottom, top) + margin);
+
+    // Walls keep every particle in the box
+    const Bounds& bounds = m_Simulation.GetBounds();
+    if (!m_Simulation.IsUnbounded() &&
+        viewMin.x <= bounds.bottomLeft.x && viewMin.y <= bounds.bottomLeft.y &&
+        viewMax.x >= bounds.topRight.x && viewMax.y >= bounds.topRight.y)
+        return -1;
+
+    // Without the grid of the last step every particle is tested, that still saves the
+    // upload and the draw
+    const SpatialGrid* grid = m_Simulation.GetCullingGrid();
+    if (!grid)
+        return GatherInRect(0, count, viewMin, viewMax, 0);
+
+    // The ones spawned after the grid was filled aren't in it
+    const int visible = GatherFromGrid(*grid, viewMin, viewMax);
+    return visible + GatherInRect(m_Simulation.GetCullingGridParticles(), count, viewMin, viewMax, visible);
+}
+
+// Every particle in the cells overlapping the view, row of cells after row of cells.
+// Rows are counted in parallel, laid out one after the other and then written in parallel
+int ParticleRenderer::GatherFromGrid(const SpatialGrid& grid, const Vec2& viewMin, const Vec2& viewMax)
+{
+    const std::vector<Particle>& particles = m_Simulation.GetParticles();
+    const float particleRadius = m_Simulation.GetParticleRadius();
+    const ParticleAttributes& attributes = m_Simulation.GetAttributes();
+    const float* radii = attributes.Has(ParticleChannel::Radius) ? attributes.GetRadius().data() : nullptr;
+
+    // Collisions moved the particles a little since the grid was filled, one more cell covers it
+    const float drift = grid.GetCellSize();
+    int minX, minY, maxX, maxY;
+    grid.GetCellCoords(Vec2(viewMin.x - drift, viewMin.y - drift), minX, minY);
+    grid.GetCellCoords(Vec2(viewMax.x + drift, viewMax.y + drift), maxX, maxY);
+    const int rows = maxY - minY + 1;
+    const int gridWidth = grid.GetGridWidth();
+    m_RowOffsets.resize(rows + 1);
+    m_RowOffsets[0] = 0;
+
+    ThreadPool& pool = ThreadPool::Get();
+    pool.ParallelFor(0, rows, [&](int begin, int end, int)
+    {
+        for (int row = begin; row < end; row++)
+        {
+            const int rowStart = (minY + row) * gridWidth;
+            int rowCount = 0;
+            for (int x = minX; x <= maxX; x++)
+                rowCount += static_cast<int>(grid.GetCell(rowStart + x).size());
+            m_RowOffsets[row + 1] = rowCount;
+        }
+    }, CULL_MIN_ROWS);
+
+    for (int row = 0; row < rows; row++)
+        m_RowOffsets[row + 1] += m_RowOffsets[row];
+
+    pool.ParallelFor(0, rows, [&](int begin, int end, int)
+    {
+        for (int row = begin; row < end; row++)
+        {
+            const int rowStart = (minY + row) * gridWidth;
+            int slot = m_RowOffsets[row];
+            for (int x = minX; x <= maxX; x++)
+                for (const int index : grid.GetCell(rowStart + x))
+                    FillInstance(m_InstanceData[slot++], particles[index], radii ? radii[index] : particleRadius);
+        }
+    }, CULL_MIN_ROWS);
+
+    return m_RowOffsets[rows];
+}
+
+// Particles [begin, end) whose centre is inside the view, written from instance offset
+// on in particle order. Every thread counts its own range first, then writes it
+int ParticleRenderer::GatherInRect(int begin, int end, const Vec2& viewMin, const Vec2& viewMax, int offset)
+{
+    const std::vector<Particle>& particles = m_Simulation.GetParticles();
+    const float particleRadius = m_Simulation.GetParticleRadius();
+    const ParticleAttributes& attributes = m_Simulation.GetAttributes();
+    const float* radii = attributes.Has(ParticleChannel::Radius) ? attributes.GetRadius().data() : nullptr;
+
+    auto inView = [&](const Vec2& position)
+    {
+        return position.x >= viewMin.x && position.x <= viewMax.x &&
+            position.y >= viewMin.y && position.y <= viewMax.y;
+    };
+
+    ThreadPool& pool = ThreadPool::Get();
+    const int threadCount = pool.GetThreadCount();
+    m_ThreadCounts.assign(threadCount, 0);
+
+    pool.ParallelFor(begin, end, [&](int chunkBegin, int chunkEnd, int thread)
+    {
+        int kept = 0;
+        for (int i = chunkBegin; i < chunkEnd; i++)
+            kept += inView(particles[i].position) ? 1 : 0;
+        m_ThreadCounts[thread] = kept;
+    }, CULL_MIN_CHUNK);
+
+    // Counts become where every thread starts writing
+    int total = offset;
+    for (int thread = 0; thread < threadCount; thread++)
+    {
+        const int kept = m_ThreadCounts[thread];
+        m_ThreadCounts[thread] = total;
+        total += kept;
+    }
+
+    // Same split as the counting pass
+    pool.ParallelFor(begin, end, [&](int chunkBegin, int chunkEnd, int thread)
+    {
+        int slot = m_ThreadCounts[thread];
+        for (int i = chunkBegin; i < chunkEnd; i++)
+            if (inView(particles[i].position))
+                FillInstance(m_InstanceData[slot++], particles[i], radii ? radii[i] : particleRadius);
+    }, CULL_MIN_CHUNK);
+
+    return total - offset;
+}
+
+void ParticleRenderer::UpdateDensityLod(int viewportWidth, int viewportHeight)
+{
+    // Simulation box in pixels, clipped to the viewport
+    const glm::mat4 mvp = m_Simulation.GetProjMatrix() * m_Simulation.GetViewMatrix();
+    const Bounds& bounds = m_Simulation.GetBounds();
+    const glm::vec4 corner0 = mvp * glm::vec4(bounds.bottomLeft.x, bounds.bottomLeft.y, 0.0f, 1.0f);
+    const glm::vec4 corner1 = mvp * glm::vec4(bounds.topRight.x, bounds.topRight.y, 0.0f, 1.0f);
+
+    const float x0 = std::max(std::min(corner0.x, corner1.x), -1.0f);
+    const float x1 = std::min(std::max(corner0.x, corner1.x), 1.0f);
+    const float y0 = std::max(std::min(corner0.y, corner1.y), -1.0f);
+    const float y1 = std::min(std::max(corner0.y, corner1.y), 1.0f);
+    const float pixels = std::max(x1 - x0, 0.0f) * 0.5f * viewportWidth * std::max(y1 - y0, 0.0f) * 0.5f * viewportHeight;
+
+    m_ParticlesPerPixel = m_Simulation.GetParticles().size() / std::max(pixels, 1.0f);
+
+    if (!m_DensityShader || !m_DensityLodEnabled)
+        m_DensityLodActive = false;
+    else if (m_DensityLodActive)
+        m_DensityLodActive = m_ParticlesPerPixel > DENSITY_LOD_EXIT;
+    else
+        m_DensityLodActive = m_ParticlesPerPixel > DENSITY_LOD_ENTER;
+}
+
+void ParticleRenderer::UpdateDensityTexture(int width, int height)
+{
+    const std::vector<Particle>& particles = m_Simulation.GetParticles();
+    m_DensitySamples.resize(particles.size());
+    m_DensityTexels.resize(size_t(width) * height * 2);
+
+    ForEachProjectedParticle(m_Simulation, width, height,
+        [&](int i, float centreX, float centreY, float radiusX, float radiusY)
+    {
+        DensitySample& sample = m_DensitySamples[i];
+
+        // Rows bottom to top like the texture, texel centres at half pixels. Written
+        // this way round NaNs count as off screen too
+        const float x = centreX - 0.5f;
+        const float y = centreY - 0.5f;
+        if (!(x > -1.0f && x < width && y > -1.0f && y < height))
+        {
+            sample.y = -2;
+            return;
+        }
+
+        // Bilinear, a lattice of particles about a pixel apart doesn't turn into stripes
+        const Vec2& velocity = particles[i].velocity;
+        sample.x = static_cast<int>(std::floor(x));
+        sample.y = static_cast<int>(std::floor(y));
+        sample.fx = x - sample.x;
+        sample.fy = y - sample.y;
+        sample.area = DENSITY_PI * radiusX * radiusY;
+        sample.speed = std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y);
+    });
+
+    // Every thread owns a band of rows and picks the samples touching it out of all
+    // of them: no atomics nor a screen per thread, and the sums come out in particle
+    // order whatever the thread count
+    ThreadPool::Get().ParallelFor(0, height, [&](int rowBegin, int rowEnd, int)
+    {
+        const unsigned int bandPixels = static_cast<unsigned int>((rowEnd - rowBegin) * width);
+        float* band = &m_DensityTexels[size_t(rowBegin) * width * 2];
+        std::fill(band, band + size_t(bandPixels) * 2, 0.0f);
+
+        for (const DensitySample& sample : m_DensitySamples)
+        {
+            if (sample.y < rowBegin - 1 || sample.y >= rowEnd)
+                continue;
+
+            for (int dy = 0; dy < 2; dy++)
+            {
+                const int row = sample.y + dy;
+                if (row < rowBegin || row >= rowEnd)
+                    continue;
+                const float weightY = dy ? sample.fy : 1.0f - sample.fy;
+
+                for (int dx = 0; dx < 2; dx++)
+                {
+                    const int column = sample.x + dx;
+                    if (column < 0 || column >= width)
+                        continue;
+                    const float area = sample.area * weightY * (dx ? sample.fx : 1.0f - sample.fx);
+                    float* texel = &band[2 * (size_t(row - rowBegin) * width + column)];
+                    texel[0] += area;
+                    texel[1] += area * sample.speed;
+                }
+            }
+        }
+
+        for (unsigned int pixel = 0; pixel < bandPixels; pixel++)
+        {
+            const float area = band[2 * pixel];
+            band[2 * pixel + 1] = area > 0.0f ? band[2 * pixel + 1] / area : 0.0f;
+        }
+    }, DENSITY_MIN_ROWS);
+
+    // Storage follows the viewport
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_DensityTexture));
+    if (width != m_DensityWidth || height != m_DensityHeight) {
+        GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, width, height, 0, GL_RG, GL_FLOAT, nullptr));
+        m_DensityWidth = width;
+        m_DensityHeight = height;
+    }
+    GLCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RG, GL_FLOAT, m_DensityTexels.data()));
+    GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+void ParticleRenderer::RenderDensity()
+{
+    m_DensityShader->Bind();
+    GLCall(glActiveTexture(GL_TEXTURE0));
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_DensityTexture));
+    m_DensityShader->setUniform1i("u_Density", 0);
+
+    m_ScreenArray->Bind();
+    m_IndexBuffer->Bind();
+    GLCall(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
+
+    m_ScreenArray->UnBind();
     m_IndexBuffer->UnBind();
-    m_Shader.UnBind();
+    GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+    m_DensityShader->UnBind();
 }
\ No newline at end of file
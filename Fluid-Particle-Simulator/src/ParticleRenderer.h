@@ -13,6 +13,15 @@ struct ParticleInstance {
     float size;          // Particle size
 };
 
+// How every particle is turned into fragments. Quads: an instanced indexed quad, 4
+// vertices each. Points: a single GL_POINTS vertex sized in the vertex shader, the
+// circle cut out with gl_PointCoord. Points fall back to quads when the discs are
+// larger than the driver's biggest point
+enum class ParticleDrawMode {
+    Quads,
+    Points
+};
+
 class ParticleRenderer {
 private:
     const SimulationSystem& m_Simulation;
@@ -22,6 +31,53 @@ private:
     VertexBuffer* m_InstanceBuffer;  // For the particle instance data
     IndexBuffer* m_IndexBuffer;      // For the quad indices
     std::vector<ParticleInstance> m_InstanceData; // Optimize memory allocation
+    int m_InstanceCount;                          // Instances uploaded by the last UpdateBuffers
+    int m_ViewportWidth;                          // As of the last UpdateBuffers
+
+    // Point sprites, reading the instance buffer as plain vertices
+    ParticleDrawMode m_DrawMode;
+    Shader* m_PointShader;     // null when the file is missing, quads are drawn then
+    VertexArray* m_PointArray;
+    float m_MaxPointSize;
+
+    float GetPixelsPerUnit() const;
+
+    // Opaque: no blending, the discs get a hard edge and simply overwrite each other
+    bool m_Opaque;
+
+    // Culling: zoomed in, only the particles in the grid cells overlapping the view are
+    // uploaded and drawn
+    bool m_CullingEnabled;
+    std::vector<int> m_RowOffsets;    // where every row of visible cells starts in the instances
+    std::vector<int> m_ThreadCounts;  // particles kept by every thread, then where it writes
+
+    int CullParticles();
+    int GatherFromGrid(const SpatialGrid& grid, const Vec2& viewMin, const Vec2& viewMax);
+    int GatherInRect(int begin, int end, const Vec2& viewMin, const Vec2& viewMax, int offset);
+
+    // Density LOD: once particles outnumber the pixels they're drawn on, they're summed
+    // on the CPU into a texture with one texel per pixel, drawn by a single full screen pass
+    struct DensitySample {
+        int x, y;         // bottom left texel of the 2x2 the centre is spread over, y = -2 off screen
+        float fx, fy;     // weight of the right column and of the top row
+        float area;       // disc area in pixels
+        float speed;
+    };
+
+    Shader* m_DensityShader;        // null when the file is missing, the LOD is off then
+    VertexArray* m_ScreenArray;     // the quad vertices, drawn as they are over the screen
+    unsigned int m_DensityTexture;  // RG32F: covered fraction, mean speed
+    int m_DensityWidth;
+    int m_DensityHeight;
+    std::vector<DensitySample> m_DensitySamples;
+    std::vector<float> m_DensityTexels;
+    bool m_DensityLodEnabled;
+    bool m_DensityLodActive;
+    float m_ParticlesPerPixel;
+
+    void UpdateDensityLod(int viewportWidth, int viewportHeight);
+    void UpdateDensityTexture(int width, int height);
+    void RenderDensity();
 
 public:
     ParticleRenderer(const SimulationSystem& simulation, const Shader& shader);
@@ -32,4 +88,27 @@ public:
     void UpdateInstanceDataPlaneColor(std::vector<ParticleInstance>& data, const std::vector<Particle>& particles);
     void UpdateBuffers();
     void Render();
+
+    // Quads by default
+    void SetDrawMode(ParticleDrawMode mode) { m_DrawMode = mode; }
+    ParticleDrawMode GetDrawMode() const { return m_DrawMode; }
+
+    // What Render actually draws, points need their shader and small enough discs
+    bool IsDrawingPoints() const;
+
+    // Skip blending, off by default. Cheaper per fragment for crowded scenes where the
+    // discs cover each other anyway, the density image still blends
+    void SetOpaque(bool opaque) { m_Opaque = opaque; }
+    bool IsOpaque() const { return m_Opaque; }
+
+    // Skip the particles off screen when zoomed in, on by default
+    void SetCulling(bool enabled) { m_CullingEnabled = enabled; }
+    int GetInstanceCount() const { return m_InstanceCount; }
+
+    // Automatic switch to the density image, on by default
+    void SetDensityLod(bool enabled) { m_DensityLodEnabled = enabled; }
+    bool IsDensityLodActive() const { return m_DensityLodActive; }
+
+    // Particles per pixel of the simulation box on screen, as of the last UpdateBuffers
+    float GetParticlesPerPixel() const { return m_ParticlesPerPixel; }
 };
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "SoftwareRenderer.h"
+#include "ParticleProjection.h"
+#include "core/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Square tiles, each drawn by one thread from start to end
+const int SPLAT_TILE_SIZE = 64;
+
+// ParticleShader: alpha = 1 - smoothstep(0.9, 1.0, d), d being the distance to the
+// centre over the radius, and fragments under 0.1 alpha are discarded, which happens
+// from d = 0.98045 on
+const float SPLAT_EDGE_START = 0.9f;
+const float SPLAT_EDGE_WIDTH = 0.1f;
+const float SPLAT_DISCARD_ALPHA = 0.1f;
+const float SPLAT_DISCARD_DISTANCE = 0.9805f;
+
+// Binning cuts the particles the same way for counting and for placing them, a
+// thread has to find its own counts again
+const int SPLAT_MIN_CHUNK = 4096;
+
+// Same ramp as ParticleShader: blue, cyan, green, yellow, red from rest to 200 units/s
+static void GetVelocityColor(const Vec2& velocity, uint8_t color[3])
+{
+    const float speed = std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y);
+    const float normalized = std::min(speed / 200.0f, 1.0f);
+
+    float r, g, b;
+    if (normalized < 0.25f)
+    {
+        r = 0.0f;
+        g = normalized / 0.25f;
+        b = 1.0f;
+    }
+    else if (normalized < 0.5f)
+    {
+        r = 0.0f;
+        g = 1.0f;
+        b = 1.0f - (normalized - 0.25f) / 0.25f;
+    }
+    else if (normalized < 0.75f)
+    {
+        r = (normalized - 0.5f) / 0.25f;
+        g = 1.0f;
+        b = 0.0f;
+    }
+    else
+    {
+        r = 1.0f;
+        g = 1.0f - (normalized - 0.75f) / 0.25f;
+        b = 0.0f;
+    }
+
+    color[0] = static_cast<uint8_t>(r * 255.0f + 0.5f);
+    color[1] = static_cast<uint8_t>(g * 255.0f + 0.5f);
+    color[2] = static_cast<uint8_t>(b * 255.0f + 0.5f);
+}
+
+SoftwareRenderer::SoftwareRenderer(int width, int height)
+    : m_Width(width), m_Height(height),
+    m_TilesX((width + SPLAT_TILE_SIZE - 1) / SPLAT_TILE_SIZE),
+    m_TilesY((height + SPLAT_TILE_SIZE - 1) / SPLAT_TILE_SIZE),
+    m_Pixels(size_t(width) * height * 4, 0)
+{
+}
+
+void SoftwareRenderer::ProjectParticles(const SimulationSystem& simulation)
+{
+    const std::vector<Particle>& particles = simulation.GetParticles();
+    m_Splats.resize(particles.size());
+
+    ForEachProjectedParticle(simulation, m_Width, m_Height, [&](int i, float x, float y, float radiusX, float radiusY)
+    {
+        // Rows top to bottom
+        Splat& splat = m_Splats[i];
+        splat.x = x;
+        splat.y = m_Height - y;
+        splat.inverseRadiusX = 1.0f / radiusX;
+        splat.inverseRadiusY = 1.0f / radiusY;
+        GetVelocityColor(particles[i].velocity, splat.color);
+
+        // Pixel centres inside the disc, clamped to the frame. Written this way
+        // round NaNs count as off screen too
+        const float left = splat.x - radiusX - 0.5f;
+        const float right = splat.x + radiusX - 0.5f;
+        const float top = splat.y - radiusY - 0.5f;
+        const float bottom = splat.y + radiusY - 0.5f;
+        if (!(right >= 0.0f && left <= m_Width - 1.0f && bottom >= 0.0f && top <= m_Height - 1.0f))
+        {
+            splat.x0 = splat.y0 = 0;
+            splat.x1 = splat.y1 = -1;
+            return;
+        }
+
+        splat.x0 = static_cast<int>(std::ceil(std::max(left, 0.0f)));
+        splat.x1 = static_cast<int>(std::min(right, m_Width - 1.0f));
+        splat.y0 = static_cast<int>(std::ceil(std::max(top, 0.0f)));
+        splat.y1 = static_cast<int>(std::min(bottom, m_Height - 1.0f));
+    });
+}
+
+template <class Function>
+void SoftwareRenderer::ForEachTile(const Splat& splat, const Function& func) const
+{
+    if (splat.x0 > splat.x1 || splat.y0 > splat.y1)
+        return;
+
+    const int tileX0 = splat.x0 / SPLAT_TILE_SIZE;
+    const int tileX1 = splat.x1 / SPLAT_TILE_SIZE;
+    const int tileY1 = splat.y1 / SPLAT_TILE_SIZE;
+    for (int tileY = splat.y0 / SPLAT_TILE_SIZE; tileY <= tileY1; tileY++)
+        for (int tileX = tileX0; tileX <= tileX1; tileX++)
+            func(tileY * m_TilesX + tileX);
+}
+
+// Counting sort of the splats by tile, in particle order within a tile since that's
+// the order the GPU blends them in. Every thread counts and then places its own
+// contiguous range of particles, the ranges are laid out in particle order
+void SoftwareRenderer::BinSplats()
+{
+    ThreadPool& pool = ThreadPool::Get();
+    const int threadCount = pool.GetThreadCount();
+    const int tileCount = m_TilesX * m_TilesY;
+    const int count = static_cast<int>(m_Splats.size());
+    m_ThreadTileCounts.assign(size_t(threadCount) * tileCount, 0);
+
+    pool.ParallelFor(0, count, [&](int begin, int end, int thread)
+    {
+        int* counts = &m_ThreadTileCounts[size_t(thread) * tileCount];
+        for (int i = begin; i < end; i++)
+            ForEachTile(m_Splats[i], [&](int tile) { counts[tile]++; });
+    }, SPLAT_MIN_CHUNK);
+
+    // Counts become where every thread starts writing in every tile
+    m_TileStart.resize(tileCount + 1);
+    int total = 0;
+    for (int tile = 0; tile < tileCount; tile++)
+    {
+        m_TileStart[tile] = total;
+        for (int thread = 0; thread < threadCount; thread++)
+        {
+            int& slot = m_ThreadTileCounts[size_t(thread) * tileCount + tile];
+            const int threadSplats = slot;
+            slot = total;
+            total += threadSplats;
+        }
+    }
+    m_TileStart[tileCount] = total;
+    m_TileSplats.resize(total);
+
+    // Same split as the counting pass
+    pool.ParallelFor(0, count, [&](int begin, int end, int thread)
+    {
+        int* cursors = &m_ThreadTileCounts[size_t(thread) * tileCount];
+        for (int i = begin; i < end; i++)
+            ForEachTile(m_Splats[i], [&](int tile) { m_TileSplats[cursors[tile]++] = i; });
+    }, SPLAT_MIN_CHUNK);
+}
+
+void SoftwareRenderer::DrawTile(int tile)
+{
+    const int x0 = (tile % m_TilesX) * SPLAT_TILE_SIZE;
+    const int y0 = (tile / m_TilesX) * SPLAT_TILE_SIZE;
+    const int x1 = std::min(x0 + SPLAT_TILE_SIZE, m_Width);
+    const int y1 = std::min(y0 + SPLAT_TILE_SIZE, m_Height);
+    const size_t stride = size_t(m_Width) * 4;
+
+    // Opaque black, like the window's clear colour. One row, copied to the others
+    const uint8_t background[4] = { 0, 0, 0, 255 };
+    uint8_t* firstRow = &m_Pixels[y0 * stride + x0 * 4];
+    for (int x = x0; x < x1; x++)
+        std::memcpy(firstRow + (x - x0) * 4, background, 4);
+    for (int y = y0 + 1; y < y1; y++)
+        std::memcpy(&m_Pixels[y * stride + x0 * 4], firstRow, (x1 - x0) * 4);
+
+    const float discardSquared = SPLAT_DISCARD_DISTANCE * SPLAT_DISCARD_DISTANCE;
+    const float opaqueSquared = SPLAT_EDGE_START * SPLAT_EDGE_START;
+    for (int k = m_TileStart[tile]; k < m_TileStart[tile + 1]; k++)
+    {
+        const Splat& splat = m_Splats[m_TileSplats[k]];
+
+        const int px0 = std::max(splat.x0, x0);
+        const int px1 = std::min(splat.x1, x1 - 1);
+        const int py0 = std::max(splat.y0, y0);
+        const int py1 = std::min(splat.y1, y1 - 1);
+
+        for (int y = py0; y <= py1; y++)
+        {
+            const float dy = (y + 0.5f - splat.y) * splat.inverseRadiusY;
+            const float dySquared = dy * dy;
+            if (dySquared >= discardSquared)
+                continue;
+
+            uint8_t* pixel = &m_Pixels[y * stride + px0 * 4];
+            for (int x = px0; x <= px1; x++, pixel += 4)
+            {
+                const float dx = (x + 0.5f - splat.x) * splat.inverseRadiusX;
+                const float distanceSquared = dx * dx + dySquared;
+                if (distanceSquared >= discardSquared)
+                    continue;
+
+                if (distanceSquared <= opaqueSquared)
+                {
+                    pixel[0] = splat.color[0];
+                    pixel[1] = splat.color[1];
+                    pixel[2] = splat.color[2];
+                    continue;
+                }
+
+                // Smooth edge, blended with SRC_ALPHA, ONE_MINUS_SRC_ALPHA
+                const float t = std::min((std::sqrt(distanceSquared) - SPLAT_EDGE_START) / SPLAT_EDGE_WIDTH, 1.0f);
+                const float alpha = 1.0f - t * t * (3.0f - 2.0f * t);
+                if (alpha < SPLAT_DISCARD_ALPHA)
+                    continue;
+
+                const int weight = static_cast<int>(alpha * 256.0f + 0.5f);
+                for (int c = 0; c < 3; c++)
+                    pixel[c] = static_cast<uint8_t>((splat.color[c] * weight + pixel[c] * (256 - weight)) >> 8);
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::Render(const SimulationSystem& simulation)
+{
+    ProjectParticles(simulation);
+    BinSplats();
+
+    // Tiles dealt round robin, a crowded region (the pile at the bottom) is shared by
+    // every thread instead of landing on the one owning those rows
+    ThreadPool& pool = ThreadPool::Get();
+    const int threadCount = pool.GetThreadCount();
+    const int tileCount = m_TilesX * m_TilesY;
+    pool.ParallelFor(0, threadCount, [&](int begin, int end, int)
+    {
+        for (int first = begin; first < end; first++)
+            for (int tile = first; tile < tileCount; tile += threadCount)
+                DrawTile(tile);
+    }, 1);
+}
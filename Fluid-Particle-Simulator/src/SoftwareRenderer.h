@@ -0,0 +1,53 @@
+#pragma once
+
+#include "physics/SimulationSystem.h"
+#include <cstdint>
+#include <vector>
+
+// CPU counterpart of ParticleRenderer for machines without a GPU or a display. Draws
+// the particles as the same anti-aliased discs with the same velocity colours as
+// ParticleShader, through GetProjMatrix() * GetViewMatrix(), alpha blended in
+// particle order over a black background, into an RGBA framebuffer.
+// The frame is cut into tiles, every particle is binned into the tiles it touches and
+// the tiles are drawn in parallel on the thread pool, each by a single thread, so
+// the result doesn't depend on the thread count
+class SoftwareRenderer {
+private:
+    // A particle projected to the screen
+    struct Splat {
+        float x, y;                            // centre in pixels, y down
+        float inverseRadiusX, inverseRadiusY;  // differ when the frame doesn't have the projection's aspect
+        int x0, y0, x1, y1;                    // pixels with their centre inside, empty when off screen
+        uint8_t color[3];
+    };
+
+    int m_Width;
+    int m_Height;
+    int m_TilesX;
+    int m_TilesY;
+    std::vector<uint8_t> m_Pixels;  // RGBA, rows top to bottom
+
+    // Kept between frames so rendering doesn't allocate once they're big enough
+    std::vector<Splat> m_Splats;
+    std::vector<int> m_TileStart;   // splats of tile t are m_TileSplats[m_TileStart[t] .. m_TileStart[t + 1])
+    std::vector<int> m_TileSplats;
+    std::vector<int> m_ThreadTileCounts;  // per thread and tile, then where that thread writes in the tile
+
+    template <class Function>
+    void ForEachTile(const Splat& splat, const Function& func) const;
+
+    void ProjectParticles(const SimulationSystem& simulation);
+    void BinSplats();
+    void DrawTile(int tile);
+
+public:
+    SoftwareRenderer(int width, int height);
+
+    void Render(const SimulationSystem& simulation);
+
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+
+    // width * height RGBA pixels of the last frame, rows top to bottom, alpha always opaque
+    const uint8_t* GetPixels() const { return m_Pixels.data(); }
+};
@@ -0,0 +1,61 @@
+#include "AllocationBenchmark.h"
+#include "BenchScenes.h"
+#include "../physics/Physics.h"
+#include "../core/AllocationCounter.h"
+#include <cstdio>
+
+// Small enough for the all pairs broadphase to keep up
+const int ALLOC_BENCH_PARTICLES = 4000;
+
+// Frames run before counting (the pile settles, the arena and the broadphase
+// structures reach their size), then the counted ones
+const int ALLOC_BENCH_WARMUP_FRAMES = 60;
+const int ALLOC_BENCH_COUNTED_FRAMES = 60;
+
+// Allocations made by the counted steps
+static unsigned long long CountSceneAllocations(BenchScene scene, BroadphaseType broadphase, SolverType solver)
+{
+    const Bounds bounds = GetBenchSceneBounds(scene, ALLOC_BENCH_PARTICLES);
+    SimulationSystem sim(bounds.bottomLeft, bounds.topRight, BENCH_PARTICLE_RADIUS, 1280);
+    sim.SetBroadphase(broadphase);
+    sim.SetSolver(solver);
+    sim.SetContinuousCollision(true);
+    sim.SetSeed(1);
+    FillBenchScene(sim, scene, ALLOC_BENCH_PARTICLES, 0.0f);
+
+    StepBenchScene(sim, ALLOC_BENCH_WARMUP_FRAMES);
+
+    const unsigned long long before = GetHeapAllocationCount();
+    StepBenchScene(sim, ALLOC_BENCH_COUNTED_FRAMES);
+    return GetHeapAllocationCount() - before;
+}
+
+int RunAllocationBenchmark()
+{
+    // Fixed particle counts, the streams would keep growing the storage
+    const BenchScene scenes[] = { BenchScene::Pile, BenchScene::Gas };
+    const BroadphaseType broadphases[] = { BroadphaseType::AllPairs, BroadphaseType::UniformGrid,
+        BroadphaseType::SweepAndPrune, BroadphaseType::SpatialHash };
+    const SolverType solvers[] = { SolverType::GaussSeidel, SolverType::Jacobi };
+    bool allocationFree = true;
+
+    printf("%-8s %-17s %-13s %12s\n", "scene", "broadphase", "solver", "allocations");
+    for (const BenchScene scene : scenes)
+    {
+        for (const BroadphaseType broadphase : broadphases)
+        {
+            for (const SolverType solver : solvers)
+            {
+                const unsigned long long allocations = CountSceneAllocations(scene, broadphase, solver);
+                allocationFree = allocationFree && allocations == 0;
+                // The one the counted steps ran, the scenes are bounded with a single size
+                printf("%-8s %-17s %-13s %12llu\n", GetBenchSceneName(scene), GetActiveBroadphaseName(),
+                    GetSolverName(solver), allocations);
+            }
+        }
+    }
+
+    if (!allocationFree)
+        printf("The step allocated after warming up\n");
+    return allocationFree ? 0 : 1;
+}
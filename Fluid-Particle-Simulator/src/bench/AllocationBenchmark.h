@@ -0,0 +1,7 @@
+#pragma once
+
+// Headless check that a warmed up step doesn't touch the heap. Steps the pile and gas
+// scenes with every broadphase and both contact solvers, reads GetHeapAllocationCount
+// before and after a run of steps and prints how many allocations happened in between.
+// Run with --bench-alloc, returns 1 if any run allocated
+int RunAllocationBenchmark();
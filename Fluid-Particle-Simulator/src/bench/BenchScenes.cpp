@@ -0,0 +1,119 @@
+#include "BenchScenes.h"
+#include "../physics/Physics.h"
+#include "../core/Random.h"
+#include <algorithm>
+#include <cmath>
+
+// Streams scene: the application's three streams, the rest of the particles fall as a block
+const float BENCH_STREAM_RATE = 150.0f;
+
+// Gas scene: every particle starts at this speed in a random direction
+const float BENCH_GAS_SPEED = 300.0f;
+
+const char* GetBenchSceneName(BenchScene scene)
+{
+    switch (scene)
+    {
+    case BenchScene::Pile: return "pile";
+    case BenchScene::Streams: return "streams";
+    case BenchScene::Gas: return "gas";
+    default: return "?";
+    }
+}
+
+// Fraction of the box covered by the particles
+static float GetSceneCoverage(BenchScene scene)
+{
+    switch (scene)
+    {
+    case BenchScene::Pile: return 0.35f;
+    case BenchScene::Streams: return 0.25f;
+    default: return 0.1f;
+    }
+}
+
+Bounds GetBenchSceneBounds(BenchScene scene, int count)
+{
+    const float particleArea = 3.14159265f * BENCH_PARTICLE_RADIUS * BENCH_PARTICLE_RADIUS;
+    const float boxArea = count * particleArea / GetSceneCoverage(scene);
+    const float width = std::sqrt(boxArea * 4.0f / 3.0f);
+    const float height = 0.75f * width;
+
+    Bounds bounds;
+    bounds.bottomLeft = Vec2(-0.5f * width, -0.5f * height);
+    bounds.topRight = Vec2(0.5f * width, 0.5f * height);
+    return bounds;
+}
+
+void FillBenchScene(SimulationSystem& sim, BenchScene scene, int count, float streamSeconds)
+{
+    const float radius = sim.GetParticleRadius();
+    const float diameter = 2.0f * radius;
+    const Bounds& bounds = sim.GetBounds();
+    const float width = bounds.topRight.x - bounds.bottomLeft.x;
+    const float height = bounds.topRight.y - bounds.bottomLeft.y;
+    const int columns = std::max(1, static_cast<int>((width - diameter) / diameter));
+    sim.ReserveParticles(count);
+
+    if (scene == BenchScene::Pile)
+    {
+        // Hexagonal rows from the floor up
+        for (int i = 0; i < count; i++)
+        {
+            const int row = i / columns;
+            const int column = i % columns;
+            sim.AddParticle(Vec2(
+                bounds.bottomLeft.x + radius + (column + 0.5f * (row & 1)) * diameter,
+                bounds.bottomLeft.y + radius + row * 0.866f * diameter), Vec2(0.0f, 0.0f));
+        }
+    }
+    else if (scene == BenchScene::Streams)
+    {
+        // Same streams as the application
+        const int perStream = static_cast<int>(BENCH_STREAM_RATE * streamSeconds);
+        sim.AddParticleStream(perStream, BENCH_STREAM_RATE, Vec2(100.0f, -100.0f), 1.0f, Vec2(0.0f, 0.0f));
+        sim.AddParticleStream(perStream, BENCH_STREAM_RATE, Vec2(-100.0f, -100.0f), 1.0f, Vec2(width - 2.0f * diameter, 0.0f));
+        sim.AddParticleStream(perStream, BENCH_STREAM_RATE, Vec2(100.0f, -100.0f), 1.0f, Vec2(0.5f * width, 0.0f));
+
+        // The block starts below the spawn points
+        const int blockCount = std::max(0, count - 3 * perStream);
+        for (int i = 0; i < blockCount; i++)
+        {
+            const int row = i / columns;
+            const int column = i % columns;
+            sim.AddParticle(Vec2(
+                bounds.bottomLeft.x + radius + column * diameter,
+                bounds.topRight.y - 4.0f * diameter - row * diameter), Vec2(10.0f, -10.0f));
+        }
+    }
+    else
+    {
+        // Jittered lattice, random and without overlaps
+        CounterRandom random(sim.GetSeed(), 0);
+        const float spacing = std::sqrt(width * height / count);
+        const int latticeColumns = std::max(1, static_cast<int>(width / spacing));
+        const float jitter = 0.45f * std::max(0.0f, spacing - diameter);
+        for (int i = 0; i < count; i++)
+        {
+            const int row = i / latticeColumns;
+            const int column = i % latticeColumns;
+            const float angle = random.NextFloat(0.0f, 6.2831853f);
+            sim.AddParticle(Vec2(
+                bounds.bottomLeft.x + (column + 0.5f) * spacing + random.NextFloat(-jitter, jitter),
+                bounds.bottomLeft.y + (row + 0.5f) * spacing + random.NextFloat(-jitter, jitter)),
+                Vec2(BENCH_GAS_SPEED * std::cos(angle), BENCH_GAS_SPEED * std::sin(angle)));
+        }
+    }
+}
+
+void StepBenchScene(SimulationSystem& sim, int frames)
+{
+    const float deltaTime = BENCH_FRAME_TIME / BENCH_SUBSTEPS;
+    for (int step = 0; step < frames * BENCH_SUBSTEPS; step++)
+        UpdatePhysics(sim, deltaTime, true);
+}
+
+const char* GetSolverName(SolverType solver)
+{
+    return solver == SolverType::Jacobi ? "jacobi" : "gauss-seidel";
+}
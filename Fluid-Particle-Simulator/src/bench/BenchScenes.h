@@ -0,0 +1,32 @@
+#pragma once
+#include "../physics/SimulationSystem.h"
+
+// Same particle size as the application
+const float BENCH_PARTICLE_RADIUS = 6.0f;
+
+// Same fixed step as the application, 60 frames per second in 6 substeps
+const float BENCH_FRAME_TIME = 1.0f / 60.0f;
+const int BENCH_SUBSTEPS = 6;
+
+// Scenes of the step benchmarks (scaling, counters)
+enum class BenchScene {
+    Pile,     // close packed at the bottom of the box, settling
+    Streams,  // three streams pouring over a block falling from the top
+    Gas       // spread over the whole box with random velocities
+};
+
+const char* GetBenchSceneName(BenchScene scene);
+
+// Box centred on the origin holding count particles of the scene at its density,
+// so runs with more particles see the same crowding
+Bounds GetBenchSceneBounds(BenchScene scene, int count);
+
+// Add the particles, for the streams scene part of them comes from streams that
+// keep spawning for streamSeconds
+void FillBenchScene(SimulationSystem& sim, BenchScene scene, int count, float streamSeconds);
+
+// Step the scene through the given number of frames, BENCH_SUBSTEPS substeps of the
+// fixed step each, with the broadphase set on it
+void StepBenchScene(SimulationSystem& sim, int frames);
+
+const char* GetSolverName(SolverType solver);
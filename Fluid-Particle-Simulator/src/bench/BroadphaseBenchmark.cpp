@@ -0,0 +1,249 @@
+#include "BroadphaseBenchmark.h"
+#include "BenchScenes.h"
+#include "../physics/SpatialGrid.h"
+#include "../physics/TiledAllPairs.h"
+#include "../physics/SweepAndPrune.h"
+#include "../physics/SpatialHash.h"
+#include "../physics/HierarchicalGrid.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cmath>
+
+// Steps timed per scene, particles jitter a bit between steps like in a real run
+const int BROADPHASE_BENCH_STEPS = 60;
+
+// Own scenes, the ones of BenchScenes.h are boxes sized to their particle count
+namespace {
+enum class BroadphaseScene {
+    Uniform,     // spread over the whole default domain
+    CornerPile,  // a stream jet piled up into the bottom left corner
+    Sparse       // a few small clusters in a domain 20 times larger
+};
+}
+
+static const char* GetSceneName(BroadphaseScene scene)
+{
+    switch (scene)
+    {
+    case BroadphaseScene::Uniform: return "uniform";
+    case BroadphaseScene::CornerPile: return "corner pile";
+    case BroadphaseScene::Sparse: return "sparse";
+    default: return "?";
+    }
+}
+
+static void MakeScene(BroadphaseScene scene, int count, Vec2& bottomLeft, Vec2& topRight,
+    std::vector<Particle>& particles)
+{
+    std::mt19937 rng(1234);
+    const float diameter = 2.0f * BENCH_PARTICLE_RADIUS;
+    particles.clear();
+    particles.reserve(count);
+
+    bottomLeft = Vec2(-1000.0f, -750.0f);
+    topRight = Vec2(1000.0f, 750.0f);
+
+    if (scene == BroadphaseScene::Uniform)
+    {
+        std::uniform_real_distribution<float> x(bottomLeft.x, topRight.x);
+        std::uniform_real_distribution<float> y(bottomLeft.y, topRight.y);
+        for (int i = 0; i < count; i++)
+            particles.emplace_back(Vec2(x(rng), y(rng)), Vec2(0.0f, 0.0f));
+    }
+    else if (scene == BroadphaseScene::CornerPile)
+    {
+        // Close packed triangle against the two walls
+        std::uniform_real_distribution<float> jitter(-0.05f * diameter, 0.05f * diameter);
+        const int side = static_cast<int>(std::ceil(std::sqrt(2.0f * count)));
+        int placed = 0;
+        for (int row = 0; row < side && placed < count; row++)
+        {
+            for (int column = 0; column < side - row && placed < count; column++, placed++)
+            {
+                const Vec2 position(
+                    bottomLeft.x + BENCH_PARTICLE_RADIUS + (column + 0.5f * (row & 1)) * diameter + jitter(rng),
+                    bottomLeft.y + BENCH_PARTICLE_RADIUS + row * 0.866f * diameter + jitter(rng));
+                particles.emplace_back(position, Vec2(0.0f, 0.0f));
+            }
+        }
+    }
+    else
+    {
+        bottomLeft = Vec2(-20000.0f, -15000.0f);
+        topRight = Vec2(20000.0f, 15000.0f);
+
+        // 8 gaussian blobs a few diameters wide
+        const int clusters = 8;
+        std::uniform_real_distribution<float> cx(bottomLeft.x * 0.9f, topRight.x * 0.9f);
+        std::uniform_real_distribution<float> cy(bottomLeft.y * 0.9f, topRight.y * 0.9f);
+        std::normal_distribution<float> spread(0.0f, 1.2f * diameter * std::sqrt(count / static_cast<float>(clusters)));
+        Vec2 centers[clusters];
+        for (int c = 0; c < clusters; c++)
+            centers[c] = Vec2(cx(rng), cy(rng));
+        for (int i = 0; i < count; i++)
+        {
+            const Vec2& center = centers[i % clusters];
+            particles.emplace_back(Vec2(center.x + spread(rng), center.y + spread(rng)), Vec2(0.0f, 0.0f));
+        }
+    }
+}
+
+// Radii from BENCH_PARTICLE_RADIUS / 3 to 10 times that, either spread evenly on a log
+// scale (powder) or 10% large grains among small ones (sediment)
+static void MakeMixedScene(bool bimodal, int count, std::vector<Particle>& particles, std::vector<float>& radii)
+{
+    std::mt19937 rng(4321);
+    std::uniform_real_distribution<float> x(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> y(-750.0f, 750.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float minRadius = BENCH_PARTICLE_RADIUS / 3.0f;
+
+    particles.clear();
+    radii.clear();
+    for (int i = 0; i < count; i++)
+    {
+        particles.emplace_back(Vec2(x(rng), y(rng)), Vec2(0.0f, 0.0f));
+        if (bimodal)
+            radii.push_back(i % 10 == 0 ? 10.0f * minRadius : minRadius);
+        else
+            radii.push_back(minRadius * std::pow(10.0f, unit(rng)));
+    }
+}
+
+typedef std::vector<std::pair<int, int>> BenchPairs;
+
+// Average microseconds per step, foundPairs gets the pairs of the last step as (lower
+// index, higher index) in sorted order, so two broadphases compare whatever order they
+// find them in. With radii only the pairs actually touching are kept, broadphases may
+// return more
+static double TimeBroadphase(Broadphase& broadphase, std::vector<Particle> particles, BenchPairs& foundPairs,
+    float maxDistance = 2.0f * BENCH_PARTICLE_RADIUS, const float* radii = nullptr)
+{
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> jitter(-0.05f * BENCH_PARTICLE_RADIUS, 0.05f * BENCH_PARTICLE_RADIUS);
+
+    // First step builds everything from scratch, not timed
+    broadphase.Update(particles);
+    broadphase.GetPotentialCollisionPairs(particles, maxDistance);
+
+    double totalMicroseconds = 0.0;
+    for (int step = 0; step < BROADPHASE_BENCH_STEPS; step++)
+    {
+        for (auto& particle : particles)
+            particle.position += Vec2(jitter(rng), jitter(rng));
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        broadphase.Update(particles);
+        const auto& pairs = broadphase.GetPotentialCollisionPairs(particles, maxDistance);
+        const auto end = std::chrono::high_resolution_clock::now();
+        totalMicroseconds += std::chrono::duration<double, std::micro>(end - start).count();
+
+        foundPairs.clear();
+        for (const auto& pair : pairs)
+        {
+            if (radii)
+            {
+                const float contact = radii[pair.first] + radii[pair.second];
+                if ((particles[pair.first].position - particles[pair.second].position).length_sq() > contact * contact)
+                    continue;
+            }
+            foundPairs.emplace_back(std::min(pair.first, pair.second), std::max(pair.first, pair.second));
+        }
+    }
+    std::sort(foundPairs.begin(), foundPairs.end());
+    return totalMicroseconds / BROADPHASE_BENCH_STEPS;
+}
+
+// Sizes spread 10x: the hierarchical grid against sweep and prune and a single hash
+// with cells fitting the largest particle
+static bool RunMixedSizeBenchmark()
+{
+    const int counts[] = { 2000, 4000, 8000 };
+    bool pairsMatch = true;
+
+    printf("\n%-12s %7s %14s %14s %14s %9s\n", "sizes", "N", "levels (us)", "sweep (us)", "big hash (us)", "contacts");
+    for (int bimodal = 0; bimodal < 2; bimodal++)
+    {
+        for (const int count : counts)
+        {
+            std::vector<Particle> particles;
+            std::vector<float> radii;
+            MakeMixedScene(bimodal != 0, count, particles, radii);
+            const float maxDistance = 2.0f * 10.0f * BENCH_PARTICLE_RADIUS / 3.0f;
+
+            HierarchicalGrid hierarchy;
+            hierarchy.SetRadii(radii.data(), BENCH_PARTICLE_RADIUS);
+            SweepAndPrune sweepAndPrune;
+            SpatialHash bigHash(1.5f * maxDistance);
+
+            BenchPairs hierarchyContacts, sweepContacts, hashContacts;
+            const double hierarchyTime = TimeBroadphase(hierarchy, particles, hierarchyContacts, maxDistance, radii.data());
+            const double sweepTime = TimeBroadphase(sweepAndPrune, particles, sweepContacts, maxDistance, radii.data());
+            const double hashTime = TimeBroadphase(bigHash, particles, hashContacts, maxDistance, radii.data());
+
+            const bool match = hierarchyContacts == sweepContacts && sweepContacts == hashContacts;
+            pairsMatch = pairsMatch && match;
+
+            printf("%-12s %7d %14.1f %14.1f %14.1f %9zu%s\n", bimodal ? "sediment" : "powder", count,
+                hierarchyTime, sweepTime, hashTime, hierarchyContacts.size(), match ? "" : "  MISMATCH");
+        }
+    }
+    return pairsMatch;
+}
+
+int RunBroadphaseBenchmark()
+{
+    const BroadphaseScene scenes[] = { BroadphaseScene::Uniform, BroadphaseScene::CornerPile,
+        BroadphaseScene::Sparse };
+    const int counts[] = { 500, 2000, 8000, 32000 };
+    bool pairsMatch = true;
+
+    printf("%-12s %7s %14s %14s %14s %14s %9s\n", "scene", "N", "grid (us)", "all pairs (us)", "sweep (us)", "hash (us)", "pairs");
+    for (const BroadphaseScene scene : scenes)
+    {
+        for (const int count : counts)
+        {
+            Vec2 bottomLeft, topRight;
+            std::vector<Particle> particles;
+            MakeScene(scene, count, bottomLeft, topRight, particles);
+
+            SpatialGrid grid(bottomLeft, topRight, 2.1f * 2.0f * BENCH_PARTICLE_RADIUS, count);
+            TiledAllPairs allPairs;
+            SweepAndPrune sweepAndPrune;
+            SpatialHash hash(1.5f * 2.0f * BENCH_PARTICLE_RADIUS);
+
+            BenchPairs gridPairs, allPairsPairs, sweepPairs, hashPairs;
+            const double gridTime = TimeBroadphase(grid, particles, gridPairs);
+            const double sweepTime = TimeBroadphase(sweepAndPrune, particles, sweepPairs);
+            const double hashTime = TimeBroadphase(hash, particles, hashPairs);
+
+            // All pairs gets too slow to be worth waiting for past a few thousand
+            double allPairsTime = -1.0;
+            if (count <= 8000)
+                allPairsTime = TimeBroadphase(allPairs, particles, allPairsPairs);
+            else
+                allPairsPairs = sweepPairs;
+
+            // The same pairs, not only as many
+            const bool match = gridPairs == sweepPairs && sweepPairs == allPairsPairs && hashPairs == sweepPairs;
+            pairsMatch = pairsMatch && match;
+
+            char allPairsColumn[32];
+            if (allPairsTime >= 0.0)
+                snprintf(allPairsColumn, sizeof(allPairsColumn), "%14.1f", allPairsTime);
+            else
+                snprintf(allPairsColumn, sizeof(allPairsColumn), "%14s", "-");
+
+            printf("%-12s %7d %14.1f %s %14.1f %14.1f %9zu%s\n", GetSceneName(scene), count,
+                gridTime, allPairsColumn, sweepTime, hashTime, gridPairs.size(), match ? "" : "  MISMATCH");
+        }
+    }
+
+    pairsMatch = RunMixedSizeBenchmark() && pairsMatch;
+
+    if (!pairsMatch)
+        printf("Broadphases disagree on the pairs found\n");
+    return pairsMatch ? 0 : 1;
+}
\ No newline at end of file
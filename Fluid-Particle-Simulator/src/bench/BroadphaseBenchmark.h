@@ -0,0 +1,8 @@
+#pragma once
+
+// Headless comparison of the broadphases (uniform grid, all pairs, sweep and prune,
+// spatial hash) on uniform, clustered and huge sparse scenes, then of the hierarchical
+// grid on scenes with a 10x size spread. Prints the average time of one
+// Update + GetPotentialCollisionPairs per step and the number of pairs found, which
+// has to match between broadphases. Run with --bench-broadphase, returns the exit code
+int RunBroadphaseBenchmark();
@@ -0,0 +1,98 @@
+#include "CounterBenchmark.h"
+#include "BenchScenes.h"
+#include "../core/ThreadPool.h"
+#include "../core/PhaseProfiler.h"
+#include <cstdio>
+
+const int COUNTER_BENCH_PARTICLES = 20000;
+
+const int COUNTER_BENCH_WARMUP_FRAMES = 30;
+const int COUNTER_BENCH_TIMED_FRAMES = 60;
+
+// Events per particle and step, or a dash when the counter is missing
+static void PrintPerParticle(const PhaseProfiler& profiler, StepPhase phase, PerfCounter counter, double particleSteps)
+{
+    if (profiler.GetCounters()->IsAvailable(counter))
+        printf(" %10.2f", profiler.GetCounter(phase, counter) / particleSteps);
+    else
+        printf(" %10s", "-");
+}
+
+static void RunScene(BenchScene scene, SolverType solver, PhaseProfiler& profiler)
+{
+    const Bounds bounds = GetBenchSceneBounds(scene, COUNTER_BENCH_PARTICLES);
+    SimulationSystem sim(bounds.bottomLeft, bounds.topRight, BENCH_PARTICLE_RADIUS, 1280);
+    sim.SetSolver(solver);
+    sim.SetContinuousCollision(true);
+    sim.SetSeed(1);
+    FillBenchScene(sim, scene, COUNTER_BENCH_PARTICLES,
+        (COUNTER_BENCH_WARMUP_FRAMES + COUNTER_BENCH_TIMED_FRAMES) * BENCH_FRAME_TIME);
+
+    StepBenchScene(sim, COUNTER_BENCH_WARMUP_FRAMES);
+
+    // The streams keep adding particles, count the average over the timed steps
+    const int startParticles = static_cast<int>(sim.GetParticles().size());
+    profiler.Reset();
+    sim.SetProfiler(&profiler);
+    StepBenchScene(sim, COUNTER_BENCH_TIMED_FRAMES);
+    sim.SetProfiler(nullptr);
+
+    const double steps = static_cast<double>(profiler.GetStepCount());
+    const double particles = 0.5 * (startParticles + sim.GetParticles().size());
+    const double particleSteps = steps * particles;
+    const bool hasCounters = profiler.GetCounters()->IsOpen();
+
+    printf("\n%s, %s, %.0f particles\n", GetBenchSceneName(scene), GetSolverName(solver), particles);
+    printf("%-11s %10s %10s %10s %10s %10s %10s\n", "phase", "ms/step", "IPC", "cycles/p", "L1D miss/p",
+        "LLC miss/p", "br miss/p");
+
+    for (int phase = 0; phase < static_cast<int>(StepPhase::Count); phase++)
+    {
+        const StepPhase stepPhase = static_cast<StepPhase>(phase);
+        printf("%-11s %10.3f", GetStepPhaseName(stepPhase), 1000.0 * profiler.GetSeconds(stepPhase) / steps);
+
+        const uint64_t cycles = profiler.GetCounter(stepPhase, PerfCounter::Cycles);
+        const uint64_t instructions = profiler.GetCounter(stepPhase, PerfCounter::Instructions);
+        if (hasCounters && cycles > 0 && profiler.GetCounters()->IsAvailable(PerfCounter::Instructions))
+            printf(" %10.2f", static_cast<double>(instructions) / cycles);
+        else
+            printf(" %10s", "-");
+
+        if (hasCounters)
+        {
+            PrintPerParticle(profiler, stepPhase, PerfCounter::Cycles, particleSteps);
+            PrintPerParticle(profiler, stepPhase, PerfCounter::L1DMisses, particleSteps);
+            PrintPerParticle(profiler, stepPhase, PerfCounter::LLCMisses, particleSteps);
+            PrintPerParticle(profiler, stepPhase, PerfCounter::BranchMisses, particleSteps);
+        }
+        printf("\n");
+    }
+}
+
+int RunCounterBenchmark()
+{
+    ThreadPool& pool = ThreadPool::Get();
+    pool.SetThreadCount(1);
+
+    PhaseProfiler profiler(pool);
+    if (profiler.EnableHardwareCounters())
+    {
+        // Some events can still be missing, e.g. the cache ones in a virtual machine
+        if (!profiler.GetCounters()->GetError().empty())
+            printf("Some hardware counters are unavailable (%s)\n", profiler.GetCounters()->GetError().c_str());
+    }
+    else
+    {
+        printf("Hardware counters unavailable (%s), only timing the phases\n",
+            profiler.GetCounters()->GetError().c_str());
+    }
+
+    const BenchScene scenes[] = { BenchScene::Pile, BenchScene::Streams, BenchScene::Gas };
+    const SolverType solvers[] = { SolverType::GaussSeidel, SolverType::Jacobi };
+    for (const BenchScene scene : scenes)
+        for (const SolverType solver : solvers)
+            RunScene(scene, solver, profiler);
+
+    pool.SetThreadCount(0);
+    return 0;
+}
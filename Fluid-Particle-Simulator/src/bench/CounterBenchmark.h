@@ -0,0 +1,9 @@
+#pragma once
+
+// Headless hardware counter profile of the step on the benchmark scenes with both
+// contact solvers, single threaded since the counters only see the calling thread.
+// For every phase prints the time, the instructions per cycle and the cycles, cache
+// misses and branch misses per particle. Without counters (not Linux, locked down
+// container, perf_event_paranoid) it says why and still prints the times.
+// Run with --bench-counters, returns the exit code
+int RunCounterBenchmark();
@@ -0,0 +1,170 @@
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "DrawBenchmark.h"
+#include "BenchScenes.h"
+#include "../ParticleRenderer.h"
+#include "../Renderer.h"
+#include "../core/Random.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+const int DRAW_BENCH_PARTICLES = 100000;
+const int DRAW_BENCH_WIDTH = 1280;
+const int DRAW_BENCH_HEIGHT = 960;
+
+// Frames before timing (buffers grow to size, the driver compiles its variants), then the timed ones
+const int DRAW_BENCH_WARMUP_FRAMES = 10;
+const int DRAW_BENCH_TIMED_FRAMES = 100;
+
+// Fragment throughput: discs of these radii in pixels scattered over the frame, as many
+// as it takes for their squares to cover it DRAW_BENCH_OVERDRAW times. Speeds go over
+// the whole colour ramp
+const float DRAW_BENCH_DISC_RADII[] = { 4.0f, 16.0f };
+const float DRAW_BENCH_OVERDRAW = 4.0f;
+const float DRAW_BENCH_MAX_SPEED = 250.0f;
+
+static void DrawFrame(ParticleRenderer& renderer)
+{
+    GLCall(glClear(GL_COLOR_BUFFER_BIT));
+    renderer.UpdateBuffers();
+    renderer.Render();
+    GLCall(glFinish());
+}
+
+// Milliseconds per frame
+static double TimeFrames(ParticleRenderer& renderer)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    for (int frame = 0; frame < DRAW_BENCH_WARMUP_FRAMES; frame++)
+        DrawFrame(renderer);
+
+    const Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < DRAW_BENCH_TIMED_FRAMES; frame++)
+        DrawFrame(renderer);
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return 1000.0 * seconds / DRAW_BENCH_TIMED_FRAMES;
+}
+
+// Points too large for the driver are drawn as quads, say so
+static const char* GetModeName(const ParticleRenderer& renderer)
+{
+    if (renderer.IsDrawingPoints())
+        return "points";
+    return renderer.GetDrawMode() == ParticleDrawMode::Points ? "quads*" : "quads";
+}
+
+int RunDrawBenchmark()
+{
+    if (!glfwInit())
+    {
+        fprintf(stderr, "Failed to initialize GLFW\n");
+        return 1;
+    }
+
+    // Same context as the window, never shown
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(DRAW_BENCH_WIDTH, DRAW_BENCH_HEIGHT, "Draw benchmark", nullptr, nullptr);
+    if (!window)
+    {
+        fprintf(stderr, "Failed to create GLFW window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (glewInit() != GLEW_OK)
+    {
+        fprintf(stderr, "Failed to initialize GLEW\n");
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 1;
+    }
+
+    GLCall(glViewport(0, 0, DRAW_BENCH_WIDTH, DRAW_BENCH_HEIGHT));
+    GLCall(glClearColor(0.0f, 0.0f, 0.0f, 1.0f));
+    GLCall(glEnable(GL_BLEND));
+    GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+    printf("Renderer: %s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    printf("%dx%d frame\n", DRAW_BENCH_WIDTH, DRAW_BENCH_HEIGHT);
+    printf("%-8s %8s %12s %-7s %12s %10s\n", "scene", "N", "radius (px)", "mode", "frame (ms)", "fps");
+
+    { // Renderers and shaders go before the context
+        Shader shader("res/shaders/ParticleShader.shader");
+
+        const BenchScene scenes[] = { BenchScene::Pile, BenchScene::Streams, BenchScene::Gas };
+        const ParticleDrawMode modes[] = { ParticleDrawMode::Quads, ParticleDrawMode::Points };
+
+        for (const BenchScene scene : scenes)
+        {
+            // Whole box in view, the streams scene starts with its block only
+            const Bounds bounds = GetBenchSceneBounds(scene, DRAW_BENCH_PARTICLES);
+            SimulationSystem sim(bounds.bottomLeft, bounds.topRight, BENCH_PARTICLE_RADIUS, DRAW_BENCH_WIDTH);
+            sim.SetSeed(1);
+            FillBenchScene(sim, scene, DRAW_BENCH_PARTICLES, 0.0f);
+
+            // Every particle drawn as a disc
+            ParticleRenderer renderer(sim, shader);
+            renderer.SetCulling(false);
+            renderer.SetDensityLod(false);
+
+            const float radiusPixels = BENCH_PARTICLE_RADIUS * DRAW_BENCH_WIDTH / (bounds.topRight.x - bounds.bottomLeft.x);
+
+            for (const ParticleDrawMode mode : modes)
+            {
+                renderer.SetDrawMode(mode);
+                const double msPerFrame = TimeFrames(renderer);
+                printf("%-8s %8zu %12.2f %-7s %12.3f %10.1f\n", GetBenchSceneName(scene), sim.GetParticles().size(),
+                    radiusPixels, GetModeName(renderer), msPerFrame, 1000.0 / msPerFrame);
+            }
+        }
+
+        // Big discs, the fragment stage dominates. Fragments are counted over the whole
+        // square of every disc, corners included, since that's what gets rasterized
+        printf("\nFragments: discs scattered over the frame, squares covering it %.0f times\n", DRAW_BENCH_OVERDRAW);
+        printf("%-8s %8s %12s %-7s %-8s %12s %10s\n", "scene", "N", "radius (px)", "mode", "blending", "frame (ms)", "Mfrag/s");
+
+        for (const float radius : DRAW_BENCH_DISC_RADII)
+        {
+            // One world unit per pixel
+            const float side = 2.0f * radius;
+            const int count = static_cast<int>(DRAW_BENCH_OVERDRAW * DRAW_BENCH_WIDTH * DRAW_BENCH_HEIGHT / (side * side));
+            SimulationSystem sim(Vec2(0.0f, 0.0f), Vec2(float(DRAW_BENCH_WIDTH), float(DRAW_BENCH_HEIGHT)), radius, DRAW_BENCH_WIDTH);
+            sim.ReserveParticles(count);
+            CounterRandom random(1, 0);
+            for (int i = 0; i < count; i++)
+            {
+                const Vec2 position(random.NextFloat(0.0f, float(DRAW_BENCH_WIDTH)), random.NextFloat(0.0f, float(DRAW_BENCH_HEIGHT)));
+                const float angle = random.NextFloat(0.0f, 6.2831853f);
+                const float speed = random.NextFloat(0.0f, DRAW_BENCH_MAX_SPEED);
+                sim.AddParticle(position, Vec2(speed * std::cos(angle), speed * std::sin(angle)));
+            }
+
+            ParticleRenderer renderer(sim, shader);
+            renderer.SetCulling(false);
+            renderer.SetDensityLod(false);
+
+            for (const ParticleDrawMode mode : modes)
+            {
+                for (int opaque = 0; opaque < 2; opaque++)
+                {
+                    renderer.SetDrawMode(mode);
+                    renderer.SetOpaque(opaque != 0);
+                    const double msPerFrame = TimeFrames(renderer);
+                    const double fragments = double(count) * side * side;
+                    printf("%-8s %8d %12.2f %-7s %-8s %12.3f %10.1f\n", "discs", count, radius, GetModeName(renderer),
+                        opaque ? "off" : "on", msPerFrame, fragments / (1000.0 * msPerFrame));
+                }
+            }
+        }
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// GPU side of ParticleRenderer: 100k particles of the benchmark scenes uploaded and
+// drawn into a hidden 1280x960 window, as instanced quads and as point sprites.
+// Every frame ends with glFinish so the time covers the rasterisation, which is CPU
+// work under a software driver like Mesa llvmpipe (LIBGL_ALWAYS_SOFTWARE=1).
+// Prints the renderer string, the time per frame and the frames per second.
+// Run with --bench-draw, returns the exit code
+int RunDrawBenchmark();
@@ -0,0 +1,201 @@
+#include "ScalingBenchmark.h"
+#include "BenchScenes.h"
+#include "../core/ThreadPool.h"
+#include "../core/PhaseProfiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Particles of the strong scaling runs, and per thread for the weak scaling ones
+const int SCALING_STRONG_PARTICLES = 20000;
+const int SCALING_WEAK_PARTICLES_PER_THREAD = 5000;
+
+// Frames run before timing (the pile settles, the gas mixes, caches and arenas warm
+// up), then the timed ones
+const int SCALING_WARMUP_FRAMES = 30;
+const int SCALING_TIMED_FRAMES = 60;
+
+const int PHASE_COUNT = static_cast<int>(StepPhase::Count);
+
+// Phase index PHASE_COUNT is the whole step
+static const char* GetPhaseName(int phase)
+{
+    return phase < PHASE_COUNT ? GetStepPhaseName(static_cast<StepPhase>(phase)) : "total";
+}
+
+struct ScalingRun {
+    BenchScene scene;
+    SolverType solver;
+    bool weak;
+    int threads;
+    int particles;  // when the timing started, the streams add more afterwards
+    long long steps;
+    double msPerStep[PHASE_COUNT + 1];
+    double imbalance[PHASE_COUNT + 1];
+    double speedup[PHASE_COUNT + 1];
+    double efficiency[PHASE_COUNT + 1];
+};
+
+// Build the scene in a box fitting count particles, run the warmup frames and time
+// the others on the current thread count
+static ScalingRun RunScene(BenchScene scene, SolverType solver, int count, PhaseProfiler& profiler)
+{
+    const Bounds bounds = GetBenchSceneBounds(scene, count);
+    SimulationSystem sim(bounds.bottomLeft, bounds.topRight, BENCH_PARTICLE_RADIUS, 1280);
+    sim.SetSolver(solver);
+    sim.SetContinuousCollision(true);
+    sim.SetSeed(1);
+    FillBenchScene(sim, scene, count, (SCALING_WARMUP_FRAMES + SCALING_TIMED_FRAMES) * BENCH_FRAME_TIME);
+
+    StepBenchScene(sim, SCALING_WARMUP_FRAMES);
+
+    ScalingRun run;
+    run.scene = scene;
+    run.solver = solver;
+    run.particles = static_cast<int>(sim.GetParticles().size());
+
+    profiler.Reset();
+    sim.SetProfiler(&profiler);
+    StepBenchScene(sim, SCALING_TIMED_FRAMES);
+    sim.SetProfiler(nullptr);
+
+    run.steps = profiler.GetStepCount();
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+    {
+        run.msPerStep[phase] = 1000.0 * profiler.GetSeconds(static_cast<StepPhase>(phase)) / run.steps;
+        run.imbalance[phase] = profiler.GetLoadImbalance(static_cast<StepPhase>(phase));
+    }
+    run.msPerStep[PHASE_COUNT] = 1000.0 * profiler.GetTotalSeconds() / run.steps;
+    run.imbalance[PHASE_COUNT] = profiler.GetTotalLoadImbalance();
+    return run;
+}
+
+// Against the single thread run of the same scene, solver and scaling. Weak scaling
+// runs threads times the work, its speedup is the scaled one
+static void ComputeScaling(ScalingRun& run, const ScalingRun& baseline)
+{
+    for (int phase = 0; phase <= PHASE_COUNT; phase++)
+    {
+        const double ratio = run.msPerStep[phase] > 0.0 ? baseline.msPerStep[phase] / run.msPerStep[phase] : 1.0;
+        run.speedup[phase] = run.weak ? ratio * run.threads : ratio;
+        run.efficiency[phase] = run.weak ? ratio : ratio / run.threads;
+    }
+}
+
+static bool WriteCsv(const std::string& path, const std::vector<ScalingRun>& runs)
+{
+    std::ofstream file(path);
+    if (!file)
+        return false;
+
+    file << std::fixed << "scene,scaling,solver,threads,particles,steps,phase,ms_per_step,speedup,efficiency,load_imbalance\n";
+    for (const ScalingRun& run : runs)
+    {
+        for (int phase = 0; phase <= PHASE_COUNT; phase++)
+        {
+            file << GetBenchSceneName(run.scene) << ',' << (run.weak ? "weak" : "strong") << ','
+                << GetSolverName(run.solver) << ',' << run.threads << ',' << run.particles << ','
+                << run.steps << ',' << GetPhaseName(phase) << ',' << std::setprecision(6) << run.msPerStep[phase]
+                << ',' << std::setprecision(4) << run.speedup[phase] << ',' << run.efficiency[phase] << ','
+                << run.imbalance[phase] << '\n';
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+static bool WriteJson(const std::string& path, const std::vector<ScalingRun>& runs, int hardwareThreads)
+{
+    std::ofstream file(path);
+    if (!file)
+        return false;
+
+    file << std::fixed << "{\n  \"hardwareThreads\": " << hardwareThreads
+        << ",\n  \"substepsPerFrame\": " << BENCH_SUBSTEPS << ",\n  \"runs\": [\n";
+    for (size_t k = 0; k < runs.size(); k++)
+    {
+        const ScalingRun& run = runs[k];
+        file << "    {\"scene\": \"" << GetBenchSceneName(run.scene) << "\", \"scaling\": \""
+            << (run.weak ? "weak" : "strong") << "\", \"solver\": \"" << GetSolverName(run.solver)
+            << "\", \"threads\": " << run.threads << ", \"particles\": " << run.particles
+            << ", \"steps\": " << run.steps << ", \"phases\": {\n";
+        for (int phase = 0; phase <= PHASE_COUNT; phase++)
+        {
+            file << "      \"" << GetPhaseName(phase) << "\": {\"msPerStep\": " << std::setprecision(6)
+                << run.msPerStep[phase] << std::setprecision(4) << ", \"speedup\": " << run.speedup[phase]
+                << ", \"efficiency\": " << run.efficiency[phase] << ", \"loadImbalance\": "
+                << run.imbalance[phase] << "}" << (phase < PHASE_COUNT ? "," : "") << "\n";
+        }
+        file << "    }}" << (k + 1 < runs.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+int RunScalingBenchmark(const char* outputPrefix)
+{
+    const BenchScene scenes[] = { BenchScene::Pile, BenchScene::Streams, BenchScene::Gas };
+    const SolverType solvers[] = { SolverType::GaussSeidel, SolverType::Jacobi };
+
+    // Powers of two, then the hardware concurrency itself
+    const int hardwareThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < hardwareThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(hardwareThreads);
+
+    ThreadPool& pool = ThreadPool::Get();
+    PhaseProfiler profiler(pool);
+    std::vector<ScalingRun> runs;
+
+    printf("%-8s %-7s %-13s %7s %7s %10s %8s %6s %6s |", "scene", "scaling", "solver", "threads", "N",
+        "step (ms)", "speedup", "eff", "imbal");
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+        printf(" %10s", GetPhaseName(phase));
+    printf("\n");
+
+    for (const BenchScene scene : scenes)
+    {
+        for (const SolverType solver : solvers)
+        {
+            for (int weak = 0; weak < 2; weak++)
+            {
+                const size_t baseline = runs.size();
+                for (const int threads : threadCounts)
+                {
+                    pool.SetThreadCount(threads);
+                    const int count = weak ? SCALING_WEAK_PARTICLES_PER_THREAD * threads : SCALING_STRONG_PARTICLES;
+
+                    ScalingRun run = RunScene(scene, solver, count, profiler);
+                    run.weak = weak != 0;
+                    run.threads = threads;
+                    ComputeScaling(run, runs.size() > baseline ? runs[baseline] : run);
+                    runs.push_back(run);
+
+                    printf("%-8s %-7s %-13s %7d %7d %10.3f %8.2f %6.2f %6.2f |", GetBenchSceneName(scene),
+                        weak ? "weak" : "strong", GetSolverName(solver), threads, run.particles,
+                        run.msPerStep[PHASE_COUNT], run.speedup[PHASE_COUNT], run.efficiency[PHASE_COUNT],
+                        run.imbalance[PHASE_COUNT]);
+                    for (int phase = 0; phase < PHASE_COUNT; phase++)
+                        printf(" %10.3f", run.msPerStep[phase]);
+                    printf("\n");
+                }
+            }
+        }
+    }
+
+    pool.SetThreadCount(0);
+
+    const std::string prefix = outputPrefix ? outputPrefix : "scaling";
+    const bool written = WriteCsv(prefix + ".csv", runs) && WriteJson(prefix + ".json", runs, hardwareThreads);
+    if (!written)
+    {
+        printf("Couldn't write %s.csv / %s.json\n", prefix.c_str(), prefix.c_str());
+        return 1;
+    }
+    printf("Results written to %s.csv and %s.json\n", prefix.c_str(), prefix.c_str());
+    return 0;
+}
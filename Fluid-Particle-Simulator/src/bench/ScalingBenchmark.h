@@ -0,0 +1,10 @@
+#pragma once
+
+// Headless thread scaling of the full step on three scenes (dense pile, streams over a
+// falling block, uniform gas) with both contact solvers, at 1, 2, 4... threads up to
+// the hardware concurrency. Strong scaling keeps the particle count fixed, weak scaling
+// gives every thread the same number of particles. Every phase of the step is timed
+// (see PhaseProfiler) and reported with its speedup, parallel efficiency and load
+// imbalance, on the console and in <outputPrefix>.csv and <outputPrefix>.json.
+// Run with --bench-scaling [outputPrefix], returns the exit code
+int RunScalingBenchmark(const char* outputPrefix);
@@ -0,0 +1,67 @@
+#include "SplatBenchmark.h"
+#include "BenchScenes.h"
+#include "../SoftwareRenderer.h"
+#include "../core/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+const int SPLAT_BENCH_PARTICLES = 100000;
+const int SPLAT_BENCH_WIDTH = 1920;
+const int SPLAT_BENCH_HEIGHT = 1080;
+
+// Renders before timing (buffers grow to size, caches warm up), then the timed ones
+const int SPLAT_BENCH_WARMUP_FRAMES = 5;
+const int SPLAT_BENCH_TIMED_FRAMES = 100;
+
+int RunSplatBenchmark()
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    const BenchScene scenes[] = { BenchScene::Pile, BenchScene::Streams, BenchScene::Gas };
+
+    // Powers of two, then the hardware concurrency itself
+    const int hardwareThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < hardwareThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(hardwareThreads);
+
+    ThreadPool& pool = ThreadPool::Get();
+    SoftwareRenderer renderer(SPLAT_BENCH_WIDTH, SPLAT_BENCH_HEIGHT);
+
+    printf("%dx%d frame\n", SPLAT_BENCH_WIDTH, SPLAT_BENCH_HEIGHT);
+    printf("%-8s %8s %12s %7s %12s %10s\n", "scene", "N", "radius (px)", "threads", "frame (ms)", "fps");
+
+    for (const BenchScene scene : scenes)
+    {
+        // Whole box in view, the streams scene starts with its block only
+        const Bounds bounds = GetBenchSceneBounds(scene, SPLAT_BENCH_PARTICLES);
+        SimulationSystem sim(bounds.bottomLeft, bounds.topRight, BENCH_PARTICLE_RADIUS, SPLAT_BENCH_WIDTH);
+        sim.SetSeed(1);
+        FillBenchScene(sim, scene, SPLAT_BENCH_PARTICLES, 0.0f);
+
+        const float radiusPixels = BENCH_PARTICLE_RADIUS * SPLAT_BENCH_WIDTH / (bounds.topRight.x - bounds.bottomLeft.x);
+
+        for (const int threads : threadCounts)
+        {
+            pool.SetThreadCount(threads);
+            for (int frame = 0; frame < SPLAT_BENCH_WARMUP_FRAMES; frame++)
+                renderer.Render(sim);
+
+            const Clock::time_point start = Clock::now();
+            for (int frame = 0; frame < SPLAT_BENCH_TIMED_FRAMES; frame++)
+                renderer.Render(sim);
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+            const double msPerFrame = 1000.0 * seconds / SPLAT_BENCH_TIMED_FRAMES;
+            printf("%-8s %8zu %12.2f %7d %12.3f %10.1f\n", GetBenchSceneName(scene), sim.GetParticles().size(),
+                radiusPixels, threads, msPerFrame, 1000.0 / msPerFrame);
+        }
+    }
+
+    pool.SetThreadCount(0);
+    return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// Headless throughput of SoftwareRenderer: 100k particles of the benchmark scenes
+// drawn into a 1920x1080 frame at 1, 2, 4... threads up to the hardware concurrency.
+// Prints the time per frame, the frames per second and the size of the discs.
+// Run with --bench-splat, returns the exit code
+int RunSplatBenchmark();
@@ -0,0 +1,43 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Constant initialized, operator new can run before main
+static std::atomic<unsigned long long> s_HeapAllocations{ 0 };
+
+unsigned long long GetHeapAllocationCount()
+{
+    return s_HeapAllocations.load(std::memory_order_relaxed);
+}
+
+// Replacements of the global allocation functions. The array and nothrow versions
+// forward to these two by default, so they're counted as well
+void* operator new(std::size_t size)
+{
+    s_HeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+
+    while (true)
+    {
+        void* memory = std::malloc(size);
+        if (memory)
+            return memory;
+
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Number of heap allocations (operator new, from every thread) since the program
+// started. Read it before and after some code to check that code doesn't allocate
+unsigned long long GetHeapAllocationCount();
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit of a non-zero word (bsf / tzcnt)
+inline int CountTrailingZeros(uint64_t bits)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#elif defined(_MSC_VER)
+    // Win32 only has the 32 bit scan
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(bits)))
+        return static_cast<int>(index);
+    _BitScanForward(&index, static_cast<unsigned long>(bits >> 32));
+    return static_cast<int>(index) + 32;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+// Call function(index) for every set bit of bits, lowest first
+template <class Function>
+inline void ForEachSetBit(uint64_t bits, Function function)
+{
+    while (bits)
+    {
+        function(CountTrailingZeros(bits));
+        bits &= bits - 1;
+    }
+}
@@ -0,0 +1,74 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t capacity)
+{
+    if (capacity > 0)
+    {
+        m_Block = new char[capacity];
+        m_Capacity = capacity;
+        m_BlockAllocations++;
+    }
+}
+
+FrameArena::~FrameArena()
+{
+    for (char* block : m_Overflow)
+        delete[] block;
+    delete[] m_Block;
+}
+
+static char* AlignUp(char* pointer, size_t alignment)
+{
+    const uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+    return reinterpret_cast<char*>((address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+}
+
+void* FrameArena::AllocateBytes(size_t size, size_t alignment)
+{
+    if (size == 0)
+        return nullptr;
+
+    // Worst case padding, the regrown block has to fit it whatever the addresses are
+    m_Requested += size + alignment - 1;
+
+    if (m_Block)
+    {
+        char* result = AlignUp(m_Block + m_Offset, alignment);
+        const size_t end = static_cast<size_t>(result - m_Block) + size;
+        if (end <= m_Capacity)
+        {
+            m_Offset = end;
+            return result;
+        }
+    }
+
+    // Doesn't fit, kept apart until the next Reset
+    char* block = new char[size + alignment - 1];
+    m_Overflow.push_back(block);
+    m_BlockAllocations++;
+    return AlignUp(block, alignment);
+}
+
+void FrameArena::Reset()
+{
+    m_Peak = std::max(m_Peak, m_Requested);
+
+    if (!m_Overflow.empty())
+    {
+        for (char* block : m_Overflow)
+            delete[] block;
+        m_Overflow.clear();
+
+        // One block for the whole step with some headroom, the particle count may still grow
+        const size_t capacity = std::max(m_Requested + m_Requested / 2, 2 * m_Capacity);
+        delete[] m_Block;
+        m_Block = new char[capacity];
+        m_Capacity = capacity;
+        m_BlockAllocations++;
+    }
+
+    m_Offset = 0;
+    m_Requested = 0;
+}
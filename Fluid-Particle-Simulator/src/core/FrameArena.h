@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+
+// Monotonic allocator for the scratch data of a step. An allocation only bumps an
+// offset in one block, nothing is freed on its own, Reset drops everything at once.
+// A step needing more than the block holds gets extra blocks for the rest, Reset
+// frees them and regrows the block to what the step used, so after the first few
+// steps everything fits and the arena doesn't touch the heap anymore
+class FrameArena {
+private:
+    char* m_Block = nullptr;
+    size_t m_Capacity = 0;
+    size_t m_Offset = 0;
+
+    std::vector<char*> m_Overflow;   // blocks of the requests that didn't fit this step
+    size_t m_Requested = 0;          // bytes asked since the last Reset, padding included
+    size_t m_Peak = 0;
+    unsigned long long m_BlockAllocations = 0;
+
+public:
+    explicit FrameArena(size_t capacity = 0);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // size bytes aligned on alignment (a power of two), null for 0 bytes
+    void* AllocateBytes(size_t size, size_t alignment);
+
+    // Uninitialized room for count objects. Nothing is ever destroyed, T can't need it
+    template <class T>
+    T* Allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+        return static_cast<T*>(AllocateBytes(count * sizeof(T), alignof(T)));
+    }
+
+    // Every pointer handed out since the last Reset becomes invalid
+    void Reset();
+
+    size_t GetUsed() const { return m_Requested; }
+    size_t GetCapacity() const { return m_Capacity; }
+    size_t GetPeak() const { return m_Peak; }
+
+    // Heap blocks allocated so far, stops moving once the arena is warm
+    unsigned long long GetBlockAllocationCount() const { return m_BlockAllocations; }
+};
@@ -0,0 +1,295 @@
+#include "ImageWriter.h"
+#include <algorithm>
+
+// ---------- Deflate (RFC 1951), one block with the fixed Huffman codes ----------
+
+// Match search: last position of every 3 byte hash, matches reach back 32 KB
+const int DEFLATE_HASH_BITS = 15;
+const int DEFLATE_WINDOW = 32768;
+const int DEFLATE_MIN_MATCH = 3;
+const int DEFLATE_MAX_MATCH = 258;
+
+static const int LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const int LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const int DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const int DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Deflate packs bits from the least significant end, Huffman codes go in reversed
+class BitWriter {
+private:
+    std::vector<uint8_t>& m_Output;
+    uint32_t m_Bits = 0;
+    int m_Count = 0;
+
+public:
+    explicit BitWriter(std::vector<uint8_t>& output) : m_Output(output) {}
+
+    void Write(uint32_t value, int count)
+    {
+        m_Bits |= value << m_Count;
+        m_Count += count;
+        while (m_Count >= 8)
+        {
+            m_Output.push_back(static_cast<uint8_t>(m_Bits));
+            m_Bits >>= 8;
+            m_Count -= 8;
+        }
+    }
+
+    void WriteCode(uint32_t code, int length)
+    {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++)
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        Write(reversed, length);
+    }
+
+    void Flush()
+    {
+        if (m_Count > 0)
+            m_Output.push_back(static_cast<uint8_t>(m_Bits));
+        m_Bits = 0;
+        m_Count = 0;
+    }
+};
+
+static void WriteSymbol(BitWriter& writer, int symbol)
+{
+    if (symbol < 144)
+        writer.WriteCode(0x30 + symbol, 8);
+    else if (symbol < 256)
+        writer.WriteCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        writer.WriteCode(symbol - 256, 7);
+    else
+        writer.WriteCode(0xC0 + symbol - 280, 8);
+}
+
+static void WriteMatch(BitWriter& writer, int length, int distance)
+{
+    int code = 28;
+    while (LENGTH_BASE[code] > length)
+        code--;
+    WriteSymbol(writer, 257 + code);
+    writer.Write(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+    code = 29;
+    while (DISTANCE_BASE[code] > distance)
+        code--;
+    writer.WriteCode(code, 5);
+    writer.Write(distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+}
+
+static uint32_t Hash3(const uint8_t* data)
+{
+    const uint32_t value = data[0] | (data[1] << 8) | (data[2] << 16);
+    return (value * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+// Greedy LZ77, every position is hashed so runs of background find their match
+static void Deflate(const std::vector<uint8_t>& data, std::vector<uint8_t>& output)
+{
+    BitWriter writer(output);
+    writer.Write(1, 1);  // last block
+    writer.Write(1, 2);  // fixed Huffman codes
+
+    std::vector<int> head(size_t(1) << DEFLATE_HASH_BITS, -1);
+    const int size = static_cast<int>(data.size());
+    int i = 0;
+    while (i < size)
+    {
+        int length = 0;
+        int distance = 0;
+        if (i + DEFLATE_MIN_MATCH <= size)
+        {
+            const uint32_t hash = Hash3(&data[i]);
+            const int candidate = head[hash];
+            head[hash] = i;
+            if (candidate >= 0 && i - candidate <= DEFLATE_WINDOW)
+            {
+                const int maxLength = std::min(DEFLATE_MAX_MATCH, size - i);
+                while (length < maxLength && data[candidate + length] == data[i + length])
+                    length++;
+                distance = i - candidate;
+            }
+        }
+
+        if (length < DEFLATE_MIN_MATCH)
+        {
+            WriteSymbol(writer, data[i]);
+            i++;
+            continue;
+        }
+
+        WriteMatch(writer, length, distance);
+        for (int j = i + 1; j < i + length && j + DEFLATE_MIN_MATCH <= size; j++)
+            head[Hash3(&data[j])] = j;
+        i += length;
+    }
+
+    WriteSymbol(writer, 256);  // end of block
+    writer.Flush();
+}
+
+// ---------- PNG ----------
+
+static uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady)
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        tableReady = true;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t Adler32(const std::vector<uint8_t>& data)
+{
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (const uint8_t byte : data)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void PushBigEndian(std::vector<uint8_t>& output, uint32_t value)
+{
+    output.push_back(static_cast<uint8_t>(value >> 24));
+    output.push_back(static_cast<uint8_t>(value >> 16));
+    output.push_back(static_cast<uint8_t>(value >> 8));
+    output.push_back(static_cast<uint8_t>(value));
+}
+
+// Length, type, data, CRC of type and data
+static void WriteChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    PushBigEndian(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    PushBigEndian(chunk, Crc32(chunk.data() + 4, chunk.size() - 4));
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
+
+bool WritePng(const std::string& path, int width, int height, const uint8_t* rgba)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write(reinterpret_cast<const char*>(SIGNATURE), sizeof(SIGNATURE));
+
+    // 8 bits per channel, RGBA, no interlacing
+    std::vector<uint8_t> header;
+    PushBigEndian(header, width);
+    PushBigEndian(header, height);
+    header.push_back(8);
+    header.push_back(6);
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+    WriteChunk(file, "IHDR", header);
+
+    // Sub filter on every row, flat background becomes zeros
+    const size_t stride = size_t(width) * 4;
+    std::vector<uint8_t> filtered;
+    filtered.reserve((stride + 1) * height);
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t* row = rgba + y * stride;
+        filtered.push_back(1);
+        for (size_t x = 0; x < stride; x++)
+            filtered.push_back(static_cast<uint8_t>(row[x] - (x >= 4 ? row[x - 4] : 0)));
+    }
+
+    // zlib stream: header without dictionary, deflate data, Adler-32 of the input
+    std::vector<uint8_t> compressed = { 0x78, 0x01 };
+    Deflate(filtered, compressed);
+    PushBigEndian(compressed, Adler32(filtered));
+    WriteChunk(file, "IDAT", compressed);
+
+    WriteChunk(file, "IEND", std::vector<uint8_t>());
+    return static_cast<bool>(file);
+}
+
+// ---------- Y4M ----------
+
+Y4mWriter::Y4mWriter(const std::string& path, int width, int height, int framesPerSecond)
+    : m_File(path, std::ios::binary), m_Width(width), m_Height(height)
+{
+    const int chromaSize = ((width + 1) / 2) * ((height + 1) / 2);
+    m_Frame.resize(size_t(width) * height + 2 * chromaSize);
+
+    // Progressive, square pixels, chroma sited like JPEG
+    m_File << "YUV4MPEG2 W" << width << " H" << height << " F" << framesPerSecond
+        << ":1 Ip A1:1 C420jpeg\n";
+}
+
+bool Y4mWriter::WriteFrame(const uint8_t* rgba)
+{
+    if (!IsOpen())
+        return false;
+
+    // BT.601 studio range, chroma from the average of every 2x2 block
+    const int chromaWidth = (m_Width + 1) / 2;
+    const int chromaHeight = (m_Height + 1) / 2;
+    uint8_t* luma = m_Frame.data();
+    uint8_t* cb = luma + m_Width * m_Height;
+    uint8_t* cr = cb + chromaWidth * chromaHeight;
+
+    for (int y = 0; y < m_Height; y++)
+    {
+        const uint8_t* pixel = rgba + size_t(y) * m_Width * 4;
+        for (int x = 0; x < m_Width; x++, pixel += 4)
+            luma[y * m_Width + x] = static_cast<uint8_t>(((66 * pixel[0] + 129 * pixel[1] + 25 * pixel[2] + 128) >> 8) + 16);
+    }
+
+    for (int cy = 0; cy < chromaHeight; cy++)
+    {
+        for (int cx = 0; cx < chromaWidth; cx++)
+        {
+            int r = 0, g = 0, b = 0, count = 0;
+            for (int y = 2 * cy; y < std::min(2 * cy + 2, m_Height); y++)
+            {
+                for (int x = 2 * cx; x < std::min(2 * cx + 2, m_Width); x++)
+                {
+                    const uint8_t* pixel = rgba + (size_t(y) * m_Width + x) * 4;
+                    r += pixel[0];
+                    g += pixel[1];
+                    b += pixel[2];
+                    count++;
+                }
+            }
+            r /= count;
+            g /= count;
+            b /= count;
+            cb[cy * chromaWidth + cx] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            cr[cy * chromaWidth + cx] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+
+    m_File << "FRAME\n";
+    m_File.write(reinterpret_cast<const char*>(m_Frame.data()), m_Frame.size());
+    return IsOpen();
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Write an 8 bit RGBA image (rows top to bottom) as a PNG. Deflate with fixed Huffman
+// codes and a single candidate match search, far from the best ratio but fast, and
+// frames that are mostly background still shrink a lot. False if the file can't be written
+bool WritePng(const std::string& path, int width, int height, const uint8_t* rgba);
+
+// Raw YUV4MPEG2 video, one 4:2:0 frame per WriteFrame, alpha is dropped. ffmpeg and
+// most players read it directly, and it costs next to nothing to write
+class Y4mWriter {
+private:
+    std::ofstream m_File;
+    int m_Width;
+    int m_Height;
+    std::vector<uint8_t> m_Frame;  // Y plane, then Cb, then Cr
+
+public:
+    Y4mWriter(const std::string& path, int width, int height, int framesPerSecond);
+
+    bool IsOpen() const { return m_File.is_open() && m_File.good(); }
+
+    // rgba holds width * height pixels, rows top to bottom
+    bool WriteFrame(const uint8_t* rgba);
+};
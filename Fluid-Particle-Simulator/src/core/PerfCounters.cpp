@@ -0,0 +1,134 @@
+#include "PerfCounters.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* GetPerfCounterName(PerfCounter counter)
+{
+    switch (counter)
+    {
+    case PerfCounter::Cycles: return "cycles";
+    case PerfCounter::Instructions: return "instructions";
+    case PerfCounter::L1DMisses: return "l1d_misses";
+    case PerfCounter::LLCMisses: return "llc_misses";
+    case PerfCounter::BranchMisses: return "branch_misses";
+    default: return "?";
+    }
+}
+
+#ifdef __linux__
+
+// Kernel event of a counter
+static void SetEvent(perf_event_attr& attributes, PerfCounter counter)
+{
+    attributes.type = PERF_TYPE_HARDWARE;
+    switch (counter)
+    {
+    case PerfCounter::Cycles: attributes.config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case PerfCounter::Instructions: attributes.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case PerfCounter::LLCMisses: attributes.config = PERF_COUNT_HW_CACHE_MISSES; break;
+    case PerfCounter::BranchMisses: attributes.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    default:
+        attributes.type = PERF_TYPE_HW_CACHE;
+        attributes.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    }
+}
+
+PerfCounters::PerfCounters()
+{
+    for (int i = 0; i < COUNTER_COUNT; i++)
+    {
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        SetEvent(attributes, static_cast<PerfCounter>(i));
+
+        // User space only, that's what paranoid level 2 still allows. The group
+        // starts disabled and is enabled as a whole once every member is in
+        attributes.disabled = m_Group < 0 ? 1 : 0;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // This thread, any CPU
+        m_Files[i] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, m_Group, 0));
+        if (m_Files[i] < 0)
+        {
+            if (m_Error.empty())
+                m_Error = std::string(GetPerfCounterName(static_cast<PerfCounter>(i))) + ": " + std::strerror(errno);
+            continue;
+        }
+        if (m_Group < 0)
+            m_Group = m_Files[i];
+    }
+
+    if (m_Group >= 0)
+    {
+        ioctl(m_Group, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_Group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    // Members first, the leader last
+    for (int i = COUNTER_COUNT - 1; i >= 0; i--)
+        if (m_Files[i] >= 0)
+            close(m_Files[i]);
+}
+
+bool PerfCounters::Read(uint64_t values[static_cast<int>(PerfCounter::Count)])
+{
+    for (int i = 0; i < COUNTER_COUNT; i++)
+        values[i] = 0;
+    if (m_Group < 0)
+        return false;
+
+    // Member count, time enabled, time running, then the members in opening order
+    uint64_t data[3 + COUNTER_COUNT];
+    const ssize_t size = read(m_Group, data, sizeof(data));
+    if (size < static_cast<ssize_t>(3 * sizeof(uint64_t)))
+        return false;
+
+    // Multiplexed with other groups, extrapolate to the whole time enabled
+    const double scale = data[2] > 0 ? static_cast<double>(data[1]) / data[2] : 0.0;
+    int member = 0;
+    for (int i = 0; i < COUNTER_COUNT; i++)
+    {
+        if (m_Files[i] < 0)
+            continue;
+        if (member < static_cast<int>(data[0]))
+            values[i] = static_cast<uint64_t>(data[3 + member] * scale);
+        member++;
+    }
+    return true;
+}
+
+#else
+
+PerfCounters::PerfCounters()
+    : m_Error("hardware counters need Linux perf_event_open")
+{
+    for (int i = 0; i < COUNTER_COUNT; i++)
+        m_Files[i] = -1;
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+bool PerfCounters::Read(uint64_t values[static_cast<int>(PerfCounter::Count)])
+{
+    for (int i = 0; i < COUNTER_COUNT; i++)
+        values[i] = 0;
+    return false;
+}
+
+#endif
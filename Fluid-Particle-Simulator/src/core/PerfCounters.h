@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Hardware events counted per phase of the step
+enum class PerfCounter {
+    Cycles,
+    Instructions,
+    L1DMisses,     // level 1 data cache read misses
+    LLCMisses,     // last level cache misses
+    BranchMisses,
+    Count
+};
+
+const char* GetPerfCounterName(PerfCounter counter);
+
+// CPU performance counters of the calling thread, through perf_event_open on Linux.
+// The events are opened as one group so they are scheduled, and read, together.
+// Anything can be missing: other platforms have no counters at all, containers and
+// perf_event_paranoid can forbid them, virtual machines often lack the cache events.
+// Missing counters read as 0, IsOpen and IsAvailable tell which ones are real
+class PerfCounters {
+private:
+    static const int COUNTER_COUNT = static_cast<int>(PerfCounter::Count);
+
+    int m_Files[COUNTER_COUNT];
+    int m_Group = -1;  // file of the first counter that opened, the group leader
+    std::string m_Error;
+
+public:
+    // Opens and starts the counters of the calling thread
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool IsOpen() const { return m_Group >= 0; }
+    bool IsAvailable(PerfCounter counter) const { return m_Files[static_cast<int>(counter)] >= 0; }
+
+    // Why the counters, or some of them, couldn't be opened
+    const std::string& GetError() const { return m_Error; }
+
+    // Counts since the counters were opened, scaled up if the kernel had to share
+    // the hardware with other groups. False, and all zero, when nothing could be read
+    bool Read(uint64_t values[static_cast<int>(PerfCounter::Count)]);
+};
@@ -0,0 +1,143 @@
+#include "PhaseProfiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+const char* GetStepPhaseName(StepPhase phase)
+{
+    switch (phase)
+    {
+    case StepPhase::Setup: return "setup";
+    case StepPhase::Integrate: return "integrate";
+    case StepPhase::Sweep: return "sweep";
+    case StepPhase::Grid: return "grid";
+    case StepPhase::Pairs: return "pairs";
+    case StepPhase::Solve: return "solve";
+    case StepPhase::Spawn: return "spawn";
+    default: return "?";
+    }
+}
+
+// Busiest over average of per thread busy times
+static double ComputeImbalance(const std::vector<double>& busySeconds)
+{
+    if (busySeconds.empty())
+        return 1.0;
+
+    double sum = 0.0;
+    double busiest = 0.0;
+    for (const double seconds : busySeconds)
+    {
+        sum += seconds;
+        busiest = std::max(busiest, seconds);
+    }
+    return sum > 0.0 ? busiest * busySeconds.size() / sum : 1.0;
+}
+
+PhaseProfiler::PhaseProfiler(ThreadPool& pool)
+    : m_Pool(pool)
+{
+    m_Pool.SetMeasureBusyTime(true);
+    Reset();
+}
+
+PhaseProfiler::~PhaseProfiler()
+{
+    m_Pool.SetMeasureBusyTime(false);
+}
+
+void PhaseProfiler::SnapshotPool()
+{
+    const int threadCount = m_Pool.GetThreadCount();
+    m_LapChunkSeconds.resize(threadCount);
+    for (int thread = 0; thread < threadCount; thread++)
+        m_LapChunkSeconds[thread] = m_Pool.GetChunkSeconds(thread);
+    m_LapWaitSeconds = m_Pool.GetWaitSeconds();
+    if (m_Counters)
+        m_Counters->Read(m_LapCounters);
+    m_LapStart = Clock::now();
+}
+
+void PhaseProfiler::Reset()
+{
+    for (auto& phase : m_Phases)
+    {
+        phase.seconds = 0.0;
+        phase.busySeconds.assign(m_Pool.GetThreadCount(), 0.0);
+        for (uint64_t& count : phase.counters)
+            count = 0;
+    }
+    m_Steps = 0;
+    SnapshotPool();
+}
+
+bool PhaseProfiler::EnableHardwareCounters()
+{
+    if (!m_Counters)
+    {
+        m_Counters.reset(new PerfCounters());
+        m_Counters->Read(m_LapCounters);
+    }
+    return m_Counters->IsOpen();
+}
+
+void PhaseProfiler::BeginStep()
+{
+    m_Steps++;
+    SnapshotPool();
+}
+
+void PhaseProfiler::Lap(StepPhase phase)
+{
+    const Clock::time_point now = Clock::now();
+    const double seconds = std::chrono::duration<double>(now - m_LapStart).count();
+    PhaseTotals& totals = m_Phases[static_cast<int>(phase)];
+    totals.seconds += seconds;
+
+    // The calling thread worked for the whole lap except while waiting on the pool
+    const double waitSeconds = m_Pool.GetWaitSeconds();
+    totals.busySeconds[0] += seconds - (waitSeconds - m_LapWaitSeconds);
+    m_LapWaitSeconds = waitSeconds;
+
+    const int threadCount = static_cast<int>(totals.busySeconds.size());
+    for (int thread = 1; thread < threadCount; thread++)
+    {
+        const double chunkSeconds = m_Pool.GetChunkSeconds(thread);
+        totals.busySeconds[thread] += chunkSeconds - m_LapChunkSeconds[thread];
+        m_LapChunkSeconds[thread] = chunkSeconds;
+    }
+
+    uint64_t counters[static_cast<int>(PerfCounter::Count)];
+    if (m_Counters && m_Counters->Read(counters))
+    {
+        for (int i = 0; i < static_cast<int>(PerfCounter::Count); i++)
+        {
+            totals.counters[i] += counters[i] - m_LapCounters[i];
+            m_LapCounters[i] = counters[i];
+        }
+    }
+
+    // Measuring isn't part of the next phase
+    m_LapStart = Clock::now();
+}
+
+double PhaseProfiler::GetTotalSeconds() const
+{
+    double seconds = 0.0;
+    for (const auto& phase : m_Phases)
+        seconds += phase.seconds;
+    return seconds;
+}
+
+double PhaseProfiler::GetLoadImbalance(StepPhase phase) const
+{
+    return ComputeImbalance(m_Phases[static_cast<int>(phase)].busySeconds);
+}
+
+double PhaseProfiler::GetTotalLoadImbalance() const
+{
+    std::vector<double> busySeconds(m_Phases[0].busySeconds.size(), 0.0);
+    for (const auto& phase : m_Phases)
+        for (size_t thread = 0; thread < busySeconds.size(); thread++)
+            busySeconds[thread] += phase.busySeconds[thread];
+    return ComputeImbalance(busySeconds);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "PerfCounters.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+// Phases of a substep, in the order UpdatePhysics runs them
+enum class StepPhase {
+    Setup,       // arena reset, broadphase choice, step constants
+    Integrate,   // forces, integration and borders
+    Sweep,       // continuous collision of the fast particles
+    Grid,        // grid or broadphase update, rest detection
+    Pairs,       // pair search and canonical order
+    Solve,       // contact pairs
+    Spawn,       // streams, emitters and kill zones
+    Count
+};
+
+const char* GetStepPhaseName(StepPhase phase);
+
+// Wall time of every step phase and how it was spread over the threads of the pool.
+// UpdatePhysics calls BeginStep and then Lap at the end of each phase, the time since
+// the previous call goes to that phase. Busy time per thread comes from the pool:
+// a worker is busy while it runs a chunk, the calling thread all the time except
+// while it waits for the workers to finish theirs. Hardware counters, when enabled,
+// are read at the same laps but only see the calling thread
+class PhaseProfiler {
+private:
+    typedef std::chrono::high_resolution_clock Clock;
+
+    struct PhaseTotals {
+        double seconds = 0.0;
+        std::vector<double> busySeconds;  // per thread, 0 is the calling thread
+        uint64_t counters[static_cast<int>(PerfCounter::Count)];
+    };
+
+    ThreadPool& m_Pool;
+    PhaseTotals m_Phases[static_cast<int>(StepPhase::Count)];
+    long long m_Steps = 0;
+
+    // Pool counters at the last lap, the next lap adds the difference
+    Clock::time_point m_LapStart;
+    std::vector<double> m_LapChunkSeconds;
+    double m_LapWaitSeconds = 0.0;
+
+    std::unique_ptr<PerfCounters> m_Counters;
+    uint64_t m_LapCounters[static_cast<int>(PerfCounter::Count)] = {};
+
+    void SnapshotPool();
+
+public:
+    // Turns on busy time measurement in the pool for as long as the profiler lives
+    explicit PhaseProfiler(ThreadPool& pool);
+    ~PhaseProfiler();
+
+    PhaseProfiler(const PhaseProfiler&) = delete;
+    PhaseProfiler& operator=(const PhaseProfiler&) = delete;
+
+    // Drop everything measured so far, needed after changing the thread count
+    void Reset();
+
+    // Open the hardware counters of the calling thread, which has to be the one that
+    // steps. False when none are available, see GetCounters()->GetError() for why
+    bool EnableHardwareCounters();
+    const PerfCounters* GetCounters() const { return m_Counters.get(); }
+
+    void BeginStep();
+    void Lap(StepPhase phase);
+
+    long long GetStepCount() const { return m_Steps; }
+    double GetSeconds(StepPhase phase) const { return m_Phases[static_cast<int>(phase)].seconds; }
+    double GetTotalSeconds() const;
+
+    // Events of a phase, 0 without counters
+    uint64_t GetCounter(StepPhase phase, PerfCounter counter) const
+    {
+        return m_Phases[static_cast<int>(phase)].counters[static_cast<int>(counter)];
+    }
+
+    // Busiest thread over the average one for a phase, 1 when the work was spread
+    // evenly. A phase running on the calling thread only gives the thread count
+    double GetLoadImbalance(StepPhase phase) const;
+    double GetTotalLoadImbalance() const;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+
+// Counter-based random numbers: every value is a pure function of (seed, stream,
+// counter), there is no hidden state advancing between calls. The particle a stream
+// spawns gets the same numbers however the frames were split into steps, however
+// many threads ran and whatever other streams did before it, which makes runs
+// replayable. The mixing function is the SplitMix64 finalizer
+
+inline uint64_t Mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+class CounterRandom {
+private:
+    uint64_t m_Key;
+    uint64_t m_Counter;
+
+public:
+    // One independent sequence per (seed, stream), starting at counter
+    CounterRandom(uint64_t seed, uint64_t stream, uint64_t counter = 0)
+        : m_Key(Mix64(seed ^ Mix64(stream + 0x9E3779B97F4A7C15ull))), m_Counter(counter)
+    {
+    }
+
+    uint64_t NextU64() { return Mix64(m_Key + 0x9E3779B97F4A7C15ull * ++m_Counter); }
+
+    // Uniform in [0, 1), 24 bits so every value is exact in a float
+    float NextFloat() { return static_cast<float>(NextU64() >> 40) * (1.0f / 16777216.0f); }
+
+    // Uniform in [min, max)
+    float NextFloat(float min, float max) { return min + (max - min) * NextFloat(); }
+
+    // Jump anywhere in the sequence
+    void Seek(uint64_t counter) { m_Counter = counter; }
+    uint64_t GetCounter() const { return m_Counter; }
+};
@@ -0,0 +1,129 @@
+#include "RenderScale.h"
+#include <algorithm>
+#include <cmath>
+
+// Weight of the newest frame in the smoothed frame time
+const float RENDER_SCALE_SMOOTHING = 0.2f;
+
+// Over target * OVER shrinks, up to target * ON counts as on target. Apart so a frame
+// right at the target (vsync) is good and a little noise doesn't shrink anything.
+// Under target * ROOM the load has clearly dropped, failed steps up are forgotten
+const float RENDER_SCALE_OVER = 1.1f;
+const float RENDER_SCALE_ON = 1.05f;
+const float RENDER_SCALE_ROOM = 0.75f;
+
+const int RENDER_SCALE_SETTLE_FRAMES = 10;
+
+// Half a second at 60 Hz before a step up, at most 4 s after failed ones. Under vsync
+// the room left isn't visible and that's how long it takes to notice the load dropped
+const int RENDER_SCALE_PROBE_FRAMES = 30;
+const int RENDER_SCALE_MAX_PROBE_FRAMES = 240;
+
+// A shrink has to take 10% off the frame time to be kept. If it doesn't, no shrinking
+// for 2 s, then twice as long each time it still doesn't, up to 16 s
+const float RENDER_SCALE_MIN_GAIN = 0.9f;
+const int RENDER_SCALE_HOLD_FRAMES = 120;
+const int RENDER_SCALE_MAX_HOLD_FRAMES = 960;
+
+RenderScale::RenderScale(float targetMs, float minScale, float startScale)
+    : m_TargetMs(targetMs),
+    m_MinLevel(std::max(1, std::min(RENDER_SCALE_STEPS, static_cast<int>(std::ceil(minScale * RENDER_SCALE_STEPS - 0.001f))))),
+    m_Level(RENDER_SCALE_STEPS), m_SmoothedMs(-1.0f), m_SettleFrames(RENDER_SCALE_SETTLE_FRAMES),
+    m_GoodFrames(0), m_ProbeDelay(RENDER_SCALE_PROBE_FRAMES), m_Probing(false),
+    m_ShrunkFromMs(-1.0f), m_ShrunkFromLevel(RENDER_SCALE_STEPS),
+    m_HoldFrames(0), m_HoldDelay(RENDER_SCALE_HOLD_FRAMES)
+{
+    const int startLevel = static_cast<int>(std::floor(startScale * RENDER_SCALE_STEPS + 0.001f));
+    m_Level = std::max(m_MinLevel, std::min(RENDER_SCALE_STEPS, startLevel));
+}
+
+bool RenderScale::SetLevel(int level)
+{
+    level = std::max(m_MinLevel, std::min(RENDER_SCALE_STEPS, level));
+    if (level == m_Level)
+        return false;
+
+    m_Level = level;
+    m_SmoothedMs = -1.0f;
+    m_ShrunkFromMs = -1.0f;
+    m_SettleFrames = RENDER_SCALE_SETTLE_FRAMES;
+    return true;
+}
+
+bool RenderScale::Update(float frameMs)
+{
+    if (m_SettleFrames > 0)
+    {
+        m_SettleFrames--;
+        return false;
+    }
+
+    m_SmoothedMs = m_SmoothedMs < 0.0f ? frameMs : m_SmoothedMs + RENDER_SCALE_SMOOTHING * (frameMs - m_SmoothedMs);
+
+    if (m_SmoothedMs > m_TargetMs * RENDER_SCALE_OVER)
+    {
+        m_GoodFrames = 0;
+
+        // The step up was one too many, back to where it was and wait longer next time
+        if (m_Probing)
+        {
+            m_Probing = false;
+            m_ProbeDelay = std::min(2 * m_ProbeDelay, RENDER_SCALE_MAX_PROBE_FRAMES);
+            return SetLevel(m_Level - 1);
+        }
+
+        // Fewer pixels didn't help, it isn't the drawing that's slow
+        if (m_ShrunkFromMs > 0.0f && m_SmoothedMs > m_ShrunkFromMs * RENDER_SCALE_MIN_GAIN)
+        {
+            m_HoldFrames = m_HoldDelay;
+            m_HoldDelay = std::min(2 * m_HoldDelay, RENDER_SCALE_MAX_HOLD_FRAMES);
+            return SetLevel(m_ShrunkFromLevel);
+        }
+
+        if (m_HoldFrames > 0)
+        {
+            m_HoldFrames--;
+            return false;
+        }
+
+        // Pixels times target / measured, at least a step down
+        const float scale = GetScale() * std::sqrt(m_TargetMs / m_SmoothedMs);
+        const int level = static_cast<int>(std::floor(scale * RENDER_SCALE_STEPS));
+        // Right after a jump the smoothed time is still catching up to the frames
+        const float shrunkFromMs = std::max(m_SmoothedMs, frameMs);
+        const int shrunkFromLevel = m_Level;
+        if (!SetLevel(std::min(level, m_Level - 1)))
+            return false;
+
+        m_ShrunkFromMs = shrunkFromMs;
+        m_ShrunkFromLevel = shrunkFromLevel;
+        return true;
+    }
+
+    if (m_SmoothedMs > m_TargetMs * RENDER_SCALE_ON)
+    {
+        m_GoodFrames = 0;
+        return false;
+    }
+
+    if (m_SmoothedMs < m_TargetMs * RENDER_SCALE_ROOM)
+    {
+        m_ProbeDelay = RENDER_SCALE_PROBE_FRAMES;
+        m_HoldFrames = 0;
+        m_HoldDelay = RENDER_SCALE_HOLD_FRAMES;
+    }
+
+    if (++m_GoodFrames < m_ProbeDelay)
+        return false;
+    m_GoodFrames = 0;
+
+    // Held long enough, the last step up is proven
+    if (m_Probing)
+    {
+        m_Probing = false;
+        m_ProbeDelay = RENDER_SCALE_PROBE_FRAMES;
+    }
+
+    m_Probing = SetLevel(m_Level + 1);
+    return m_Probing;
+}
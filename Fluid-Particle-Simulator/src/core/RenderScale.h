@@ -0,0 +1,40 @@
+#pragma once
+
+// Picks the fraction of the window resolution the scene is drawn at so frames stay
+// under a target time. Software rasterizers cost about in proportion to the pixels,
+// so a slow frame shrinks the area by target / measured at once. Growing back goes a
+// step at a time after enough frames on target. A step that brings the slowness back
+// is undone and the next try waits twice as long, so the scale settles instead of
+// bouncing, also when vsync holds every frame at the target exactly. A shrink that
+// doesn't make frames faster (the physics is what's slow) is undone as well and
+// shrinking waits, so a CPU bound frame doesn't drag the scale down to the minimum.
+// Scales are multiples of 1 / RENDER_SCALE_STEPS so the target isn't resized every frame
+const int RENDER_SCALE_STEPS = 20;
+
+class RenderScale {
+private:
+    float m_TargetMs;
+    int m_MinLevel;        // scale = level / RENDER_SCALE_STEPS
+    int m_Level;
+    float m_SmoothedMs;    // negative until measured at this scale
+    int m_SettleFrames;    // frames ignored after a change, the first ones pay for it
+    int m_GoodFrames;      // frames on target in a row
+    int m_ProbeDelay;      // frames on target before trying a step up
+    bool m_Probing;        // the last change was a step up, not proven yet
+    float m_ShrunkFromMs;  // smoothed time before the last shrink, negative otherwise
+    int m_ShrunkFromLevel;
+    int m_HoldFrames;      // slow frames left that don't shrink, after a useless shrink
+    int m_HoldDelay;
+
+    bool SetLevel(int level);
+
+public:
+    // Starts at startScale, never goes under minScale nor over 1
+    RenderScale(float targetMs, float minScale, float startScale = 1.0f);
+
+    // Duration of the frame just finished, true when the scale changed
+    bool Update(float frameMs);
+
+    float GetScale() const { return static_cast<float>(m_Level) / RENDER_SCALE_STEPS; }
+    float GetTargetMs() const { return m_TargetMs; }
+};
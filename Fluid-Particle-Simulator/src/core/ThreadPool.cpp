@@ -0,0 +1,133 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+
+typedef std::chrono::high_resolution_clock BusyClock;
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    StartWorkers(threadCount);
+}
+
+ThreadPool::~ThreadPool()
+{
+    StopWorkers();
+}
+
+ThreadPool& ThreadPool::Get()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::StartWorkers(unsigned int threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    m_Stop = false;
+    m_ChunkSeconds.assign(threadCount, 0.0);
+    m_WaitSeconds = 0.0;
+    for (unsigned int i = 1; i < threadCount; i++)
+        m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, static_cast<int>(i), m_Generation);
+}
+
+void ThreadPool::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WakeCondition.notify_all();
+
+    for (auto& worker : m_Workers)
+        worker.join();
+    m_Workers.clear();
+}
+
+void ThreadPool::SetThreadCount(unsigned int threadCount)
+{
+    StopWorkers();
+    StartWorkers(threadCount);
+}
+
+void ThreadPool::RunChunk(int chunk) const
+{
+    // Same split for every thread count: chunk k covers [begin + k * n / chunks, ...)
+    const long long count = m_JobEnd - m_JobBegin;
+    const int chunkBegin = m_JobBegin + static_cast<int>(count * chunk / m_JobChunks);
+    const int chunkEnd = m_JobBegin + static_cast<int>(count * (chunk + 1) / m_JobChunks);
+    m_JobInvoke(m_JobFunction, chunkBegin, chunkEnd, chunk);
+}
+
+void ThreadPool::WorkerLoop(int threadIndex, unsigned long long startGeneration)
+{
+    // Jobs issued before this worker existed are not its business
+    unsigned long long seenGeneration = startGeneration;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WakeCondition.wait(lock, [&] { return m_Stop || m_Generation != seenGeneration; });
+            if (m_Stop)
+                return;
+            seenGeneration = m_Generation;
+            if (threadIndex >= m_JobChunks)
+                continue;
+        }
+
+        if (m_MeasureBusyTime)
+        {
+            const BusyClock::time_point start = BusyClock::now();
+            RunChunk(threadIndex);
+            m_ChunkSeconds[threadIndex] += std::chrono::duration<double>(BusyClock::now() - start).count();
+        }
+        else
+        {
+            RunChunk(threadIndex);
+        }
+
+        if (m_PendingChunks.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_DoneCondition.notify_one();
+        }
+    }
+}
+
+void ThreadPool::Run(int begin, int end, JobInvoke invoke, const void* func, int minChunkSize)
+{
+    const int count = end - begin;
+    if (count <= 0)
+        return;
+
+    const int chunks = std::max(1, std::min(GetThreadCount(), count / std::max(1, minChunkSize)));
+    if (chunks == 1)
+    {
+        invoke(func, begin, end, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_JobInvoke = invoke;
+        m_JobFunction = func;
+        m_JobBegin = begin;
+        m_JobEnd = end;
+        m_JobChunks = chunks;
+        m_PendingChunks = chunks - 1;
+        m_Generation++;
+    }
+    m_WakeCondition.notify_all();
+
+    // The caller always takes the first chunk
+    RunChunk(0);
+
+    const BusyClock::time_point waitStart = m_MeasureBusyTime ? BusyClock::now() : BusyClock::time_point();
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_DoneCondition.wait(lock, [&] { return m_PendingChunks.load() == 0; });
+    if (m_MeasureBusyTime)
+        m_WaitSeconds += std::chrono::duration<double>(BusyClock::now() - waitStart).count();
+    m_JobInvoke = nullptr;
+    m_JobFunction = nullptr;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Minimal persistent thread pool used to parallelize the simulation step.
+// Work is always split into contiguous chunks, chunk k is executed by thread k
+// (the calling thread takes chunk 0) so partial results can be stored per thread
+// and combined afterwards without atomics.
+class ThreadPool {
+private:
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCondition;
+    std::condition_variable m_DoneCondition;
+
+    // Current job, the caller's function object called through a typed trampoline.
+    // Wrapping it in a std::function would heap allocate on every call
+    typedef void (*JobInvoke)(const void* func, int begin, int end, int thread);
+    JobInvoke m_JobInvoke = nullptr;
+    const void* m_JobFunction = nullptr;
+    int m_JobBegin = 0;
+    int m_JobEnd = 0;
+    int m_JobChunks = 0;
+    unsigned long long m_Generation = 0;
+    std::atomic<int> m_PendingChunks{ 0 };
+    bool m_Stop = false;
+
+    // Busy time accounting (PhaseProfiler). Thread k only ever writes its own slot
+    bool m_MeasureBusyTime = false;
+    std::vector<double> m_ChunkSeconds;
+    double m_WaitSeconds = 0.0;
+
+    void WorkerLoop(int threadIndex, unsigned long long startGeneration);
+    void RunChunk(int chunk) const;
+    void StartWorkers(unsigned int threadCount);
+    void StopWorkers();
+    void Run(int begin, int end, JobInvoke invoke, const void* func, int minChunkSize);
+
+    template <class Function>
+    static void InvokeJob(const void* func, int begin, int end, int thread)
+    {
+        (*static_cast<const Function*>(func))(begin, end, thread);
+    }
+
+public:
+    // threadCount includes the calling thread, 0 means hardware concurrency
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Shared pool used by the simulation
+    static ThreadPool& Get();
+
+    // Number of threads taking part in ParallelFor (workers + caller)
+    int GetThreadCount() const { return static_cast<int>(m_Workers.size()) + 1; }
+
+    // Restart the pool with a different number of threads (0 = hardware concurrency)
+    void SetThreadCount(unsigned int threadCount);
+
+    // Off by default. While on, every worker adds up the time it spends running chunks
+    // and the calling thread the time it spends waiting for them. Read the totals
+    // between two ParallelFor calls
+    void SetMeasureBusyTime(bool measure) { m_MeasureBusyTime = measure; }
+    double GetChunkSeconds(int thread) const { return m_ChunkSeconds[thread]; }
+    double GetWaitSeconds() const { return m_WaitSeconds; }
+
+    // Split [begin, end) into at most GetThreadCount() contiguous chunks of at least
+    // minChunkSize elements and call func(chunkBegin, chunkEnd, threadIndex) on each.
+    // Blocks until every chunk is done. Small ranges run inline on the caller
+    template <class Function>
+    void ParallelFor(int begin, int end, const Function& func, int minChunkSize = 1024)
+    {
+        Run(begin, end, &InvokeJob<Function>, &func, minChunkSize);
+    }
+};
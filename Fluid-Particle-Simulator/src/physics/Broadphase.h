@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include "Particle.h"
+
+// Common interface of the structures that find the candidate collision pairs
+// (SpatialGrid, TiledAllPairs, SweepAndPrune) so UpdatePhysics can swap them.
+// Every implementation returns the same set of pairs for the same positions,
+// only the order of the pairs (and inside a pair) may differ
+class Broadphase {
+public:
+    virtual ~Broadphase() {}
+
+    // Rebuild or refresh the structure from the current positions
+    virtual void Update(const std::vector<Particle>& particles) = 0;
+
+    // Every pair closer than maxDistance as of the last Update, each unordered
+    // pair reported once. The vector is reused by the next call
+    virtual std::vector<std::pair<int, int>>& GetPotentialCollisionPairs(
+        const std::vector<Particle>& particles,
+        float maxDistance) = 0;
+
+    virtual const char* GetName() const = 0;
+};
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+#include "Vec2.h"
+
+// Emitters add particles in batches: every step the particles due since the last one
+// are appended at once (SimulationSystem::SpawnBatch) and their slots written in a
+// single pass. The shape only decides where they appear and how they're launched
+enum class EmitterShape {
+    Point,   // all from position
+    Line,    // anywhere on the segment from position to end
+    Disc,    // anywhere inside the disc of radius size around position
+    Burst    // the whole total at once inside the disc, launched outwards at the speed of velocity.
+             // One shot, a burst without a total spawns nothing
+};
+
+struct Emitter {
+    EmitterShape shape = EmitterShape::Point;
+    Vec2 position;
+    Vec2 end;              // Line only
+    float size = 0.0f;     // Disc and Burst radius
+    Vec2 velocity;
+    float spread = 0.0f;   // random turn of the velocity, at most spread / 2 either way (radians)
+    float rate = 100.0f;   // particles per second, Burst ignores it. Nothing is spawned while <= 0
+    long long total = -1;  // particles over the emitter's life, negative for no limit
+    float mass = 1.0f;
+    float radius = 0.0f;   // 0 means the simulation's radius
+    bool active = true;
+
+    // Progress, kept up by the simulation
+    float timer = 0.0f;
+    long long emitted = 0;
+};
+
+// Particles whose center is inside the box are removed at the end of the step
+struct KillZone {
+    Vec2 bottomLeft;
+    Vec2 topRight;
+};
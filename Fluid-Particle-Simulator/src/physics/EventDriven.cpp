@@ -0,0 +1,348 @@
+#include "EventDriven.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+const double NEVER = std::numeric_limits<double>::infinity();
+
+EventDrivenSolver::EventDrivenSolver(SimulationSystem& simulation)
+    : m_Simulation(simulation)
+{
+}
+
+void EventDrivenSolver::Reset()
+{
+    std::vector<Particle>& particles = m_Simulation.GetParticles();
+    const int N = static_cast<int>(particles.size());
+
+    // Particles are expected to be synchronized at m_Time (end of the previous Advance)
+    m_LocalTime.assign(N, m_Time);
+    m_CollisionCount.assign(N, 0);
+    m_CellX.resize(N);
+    m_CellY.resize(N);
+    m_Events.assign(N, Event());
+
+    // Rebuild the cell lists on a fresh grid, cells are always wider than a particle
+    // diameter so collisions can only happen between neighbouring cells
+    m_Simulation.InitSpatialGrid();
+    SpatialGrid& grid = *m_Simulation.GetSpatialGrid();
+    for (int i = 0; i < N; i++)
+    {
+        grid.GetCellCoords(particles[i].position, m_CellX[i], m_CellY[i]);
+        grid.InsertParticleInCell(i, m_CellX[i] + m_CellY[i] * grid.GetGridWidth());
+    }
+
+    for (int i = 0; i < N; i++)
+        PredictEvent(i);
+
+    // Build the heap in O(N)
+    m_Heap.resize(N);
+    m_HeapPos.resize(N);
+    for (int i = 0; i < N; i++)
+    {
+        m_Heap[i] = i;
+        m_HeapPos[i] = i;
+    }
+    for (int pos = N / 2 - 1; pos >= 0; pos--)
+        HeapSiftDown(pos);
+
+    m_TopologyVersion = m_Simulation.GetTopologyVersion();
+    m_Initialized = true;
+}
+
+void EventDrivenSolver::Advance(float deltaTime)
+{
+    std::vector<Particle>& particles = m_Simulation.GetParticles();
+    if (!m_Initialized || m_Simulation.GetTopologyVersion() != m_TopologyVersion)
+        Reset();
+
+    SpatialGrid& grid = *m_Simulation.GetSpatialGrid();
+    const int gridWidth = grid.GetGridWidth();
+    const double endTime = m_Time + deltaTime;
+
+    while (!m_Heap.empty())
+    {
+        const int i = m_Heap[0];
+        const Event event = m_Events[i];
+        if (event.time > endTime)
+            break;
+
+        m_Time = event.time;
+        m_ProcessedEvents++;
+        AdvanceParticle(i, m_Time);
+
+        Particle& particle = particles[i];
+        switch (event.type)
+        {
+        case EventType::Particle:
+        {
+            const int j = event.partner;
+            // Partner changed trajectory after the prediction, just predict again
+            if (m_CollisionCount[j] != event.partnerCount)
+                break;
+
+            AdvanceParticle(j, m_Time);
+            ResolveCollision(i, j);
+            PredictEvent(j);
+            HeapUpdate(j);
+            break;
+        }
+        case EventType::WallX:
+        {
+            const Bounds& bounds = m_Simulation.GetBounds();
+            const float radius = m_Simulation.GetParticleRadius();
+            particle.velocity.x = -particle.velocity.x;
+            particle.position.x = std::min(std::max(particle.position.x, bounds.bottomLeft.x + radius), bounds.topRight.x - radius);
+            m_CollisionCount[i]++;
+            break;
+        }
+        case EventType::WallY:
+        {
+            const Bounds& bounds = m_Simulation.GetBounds();
+            const float radius = m_Simulation.GetParticleRadius();
+            particle.velocity.y = -particle.velocity.y;
+            particle.position.y = std::min(std::max(particle.position.y, bounds.bottomLeft.y + radius), bounds.topRight.y - radius);
+            m_CollisionCount[i]++;
+            break;
+        }
+        case EventType::CellX:
+        case EventType::CellY:
+        {
+            // Trajectory does not change, events predicted by other particles stay valid
+            grid.RemoveParticleFromCell(i, m_CellX[i] + m_CellY[i] * gridWidth);
+            if (event.type == EventType::CellX)
+                m_CellX[i] += (particle.velocity.x > 0.0f) ? 1 : -1;
+            else
+                m_CellY[i] += (particle.velocity.y > 0.0f) ? 1 : -1;
+            grid.InsertParticleInCell(i, m_CellX[i] + m_CellY[i] * gridWidth);
+            break;
+        }
+        case EventType::None:
+            break;
+        }
+
+        PredictEvent(i);
+        HeapUpdate(i);
+    }
+
+    // Synchronize every particle so the renderer sees a consistent state,
+    // trajectories are unchanged so the scheduled events remain valid
+    m_Time = endTime;
+    for (int i = 0; i < static_cast<int>(particles.size()); i++)
+        AdvanceParticle(i, m_Time);
+}
+
+void EventDrivenSolver::AdvanceParticle(int i, double t)
+{
+    const float dt = static_cast<float>(t - m_LocalTime[i]);
+    if (dt == 0.0f)
+        return;
+
+    Particle& particle = m_Simulation.GetParticles()[i];
+    particle.position.x += particle.velocity.x * dt;
+    particle.position.y += particle.velocity.y * dt;
+    m_LocalTime[i] = t;
+}
+
+double EventDrivenSolver::PredictCollisionTime(int i, int j) const
+{
+    const std::vector<Particle>& particles = m_Simulation.GetParticles();
+    const Particle& a = particles[i];
+    const Particle& b = particles[j];
+
+    // Extrapolate j to the current time, i is already there
+    const double tj = m_Time - m_LocalTime[j];
+    const double dx = (b.position.x + b.velocity.x * tj) - a.position.x;
+    const double dy = (b.position.y + b.velocity.y * tj) - a.position.y;
+    const double dvx = static_cast<double>(b.velocity.x) - a.velocity.x;
+    const double dvy = static_cast<double>(b.velocity.y) - a.velocity.y;
+
+    // Particles moving apart never collide
+    const double bij = dx * dvx + dy * dvy;
+    if (bij >= 0.0)
+        return -1.0;
+
+    const double diameter = 2.0 * m_Simulation.GetParticleRadius();
+    const double dv2 = dvx * dvx + dvy * dvy;
+    const double dr2 = dx * dx + dy * dy;
+    const double overlap = dr2 - diameter * diameter;
+
+    // Already touching and approaching, collide right away
+    if (overlap <= 0.0)
+        return 0.0;
+
+    const double discriminant = bij * bij - dv2 * overlap;
+    if (discriminant < 0.0)
+        return -1.0;
+
+    return -(bij + std::sqrt(discriminant)) / dv2;
+}
+
+void EventDrivenSolver::PredictEvent(int i)
+{
+    const std::vector<Particle>& particles = m_Simulation.GetParticles();
+    const SpatialGrid& grid = *m_Simulation.GetSpatialGrid();
+    const Bounds& bounds = m_Simulation.GetBounds();
+    const float radius = m_Simulation.GetParticleRadius();
+    const Particle& particle = particles[i];
+    const Vec2& pos = particle.position;
+    const Vec2& vel = particle.velocity;
+
+    Event best;
+    best.time = NEVER;
+
+    // Border collisions
+    if (vel.x != 0.0f)
+    {
+        const double wall = (vel.x > 0.0f) ? (bounds.topRight.x - radius) : (bounds.bottomLeft.x + radius);
+        const double t = std::max(0.0, (wall - pos.x) / vel.x);
+        if (m_Time + t < best.time) { best.time = m_Time + t; best.type = EventType::WallX; }
+    }
+    if (vel.y != 0.0f)
+    {
+        const double wall = (vel.y > 0.0f) ? (bounds.topRight.y - radius) : (bounds.bottomLeft.y + radius);
+        const double t = std::max(0.0, (wall - pos.y) / vel.y);
+        if (m_Time + t < best.time) { best.time = m_Time + t; best.type = EventType::WallY; }
+    }
+
+    // Cell crossings, edge cells extend to infinity because the grid clamps positions
+    const int cx = m_CellX[i];
+    const int cy = m_CellY[i];
+    const double cellSize = grid.GetCellSize();
+    const Vec2& minBound = grid.GetMinBound();
+    if (vel.x > 0.0f && cx < grid.GetGridWidth() - 1)
+    {
+        const double t = std::max(0.0, (minBound.x + (cx + 1) * cellSize - pos.x) / vel.x);
+        if (m_Time + t < best.time) { best.time = m_Time + t; best.type = EventType::CellX; }
+    }
+    else if (vel.x < 0.0f && cx > 0)
+    {
+        const double t = std::max(0.0, (minBound.x + cx * cellSize - pos.x) / vel.x);
+        if (m_Time + t < best.time) { best.time = m_Time + t; best.type = EventType::CellX; }
+    }
+    if (vel.y > 0.0f && cy < grid.GetGridHeight() - 1)
+    {
+        const double t = std::max(0.0, (minBound.y + (cy + 1) * cellSize - pos.y) / vel.y);
+        if (m_Time + t < best.time) { best.time = m_Time + t; best.type = EventType::CellY; }
+    }
+    else if (vel.y < 0.0f && cy > 0)
+    {
+        const double t = std::max(0.0, (minBound.y + cy * cellSize - pos.y) / vel.y);
+        if (m_Time + t < best.time) { best.time = m_Time + t; best.type = EventType::CellY; }
+    }
+
+    // Collisions with particles in the 3x3 neighbourhood
+    const int minX = std::max(0, cx - 1);
+    const int maxX = std::min(grid.GetGridWidth() - 1, cx + 1);
+    const int minY = std::max(0, cy - 1);
+    const int maxY = std::min(grid.GetGridHeight() - 1, cy + 1);
+    for (int y = minY; y <= maxY; ++y)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            for (const int j : grid.GetCell(x + y * grid.GetGridWidth()))
+            {
+                if (j == i) continue;
+
+                const double t = PredictCollisionTime(i, j);
+                if (t >= 0.0 && m_Time + t < best.time)
+                {
+                    best.time = m_Time + t;
+                    best.type = EventType::Particle;
+                    best.partner = j;
+                    best.partnerCount = m_CollisionCount[j];
+                }
+            }
+        }
+    }
+
+    m_Events[i] = best;
+}
+
+void EventDrivenSolver::ResolveCollision(int i, int j)
+{
+    std::vector<Particle>& particles = m_Simulation.GetParticles();
+    Particle& a = particles[i];
+    Particle& b = particles[j];
+
+    const float dx = b.position.x - a.position.x;
+    const float dy = b.position.y - a.position.y;
+    const float distance = std::sqrt(dx * dx + dy * dy);
+    if (distance < 1e-5f) return;
+
+    const float nx = dx / distance;
+    const float ny = dy / distance;
+    const float velocityAlongNormal = (b.velocity.x - a.velocity.x) * nx + (b.velocity.y - a.velocity.y) * ny;
+
+    if (velocityAlongNormal < 0.0f)
+    {
+        // Perfectly elastic impulse
+        const float massA = m_Simulation.GetParticleMass(i);
+        const float massB = m_Simulation.GetParticleMass(j);
+        const float impulse = 2.0f * velocityAlongNormal / (1.0f / massA + 1.0f / massB);
+        a.velocity.x += impulse * nx / massA;
+        a.velocity.y += impulse * ny / massA;
+        b.velocity.x -= impulse * nx / massB;
+        b.velocity.y -= impulse * ny / massB;
+        m_CollisionEvents++;
+    }
+
+    m_CollisionCount[i]++;
+    m_CollisionCount[j]++;
+}
+
+double EventDrivenSolver::ComputeKineticEnergy() const
+{
+    double energy = 0.0;
+    const std::vector<Particle>& particles = m_Simulation.GetParticles();
+    for (size_t i = 0; i < particles.size(); i++)
+        energy += 0.5 * m_Simulation.GetParticleMass(static_cast<int>(i)) * particles[i].velocity.length_sq();
+    return energy;
+}
+
+void EventDrivenSolver::HeapSiftUp(int pos)
+{
+    const int particle = m_Heap[pos];
+    const double time = m_Events[particle].time;
+    while (pos > 0)
+    {
+        const int parent = (pos - 1) / 2;
+        if (m_Events[m_Heap[parent]].time <= time)
+            break;
+        m_Heap[pos] = m_Heap[parent];
+        m_HeapPos[m_Heap[pos]] = pos;
+        pos = parent;
+    }
+    m_Heap[pos] = particle;
+    m_HeapPos[particle] = pos;
+}
+
+void EventDrivenSolver::HeapSiftDown(int pos)
+{
+    const int size = static_cast<int>(m_Heap.size());
+    const int particle = m_Heap[pos];
+    const double time = m_Events[particle].time;
+    while (true)
+    {
+        int child = 2 * pos + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && m_Events[m_Heap[child + 1]].time < m_Events[m_Heap[child]].time)
+            child++;
+        if (time <= m_Events[m_Heap[child]].time)
+            break;
+        m_Heap[pos] = m_Heap[child];
+        m_HeapPos[m_Heap[pos]] = pos;
+        pos = child;
+    }
+    m_Heap[pos] = particle;
+    m_HeapPos[particle] = pos;
+}
+
+void EventDrivenSolver::HeapUpdate(int particle)
+{
+    // The key can move in both directions
+    const int pos = m_HeapPos[particle];
+    HeapSiftUp(pos);
+    HeapSiftDown(m_HeapPos[particle]);
+}
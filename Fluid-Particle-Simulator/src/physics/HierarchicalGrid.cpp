@@ -0,0 +1,148 @@
+#include "HierarchicalGrid.h"
+#include <cmath>
+#include <algorithm>
+
+// Cells of the finest level relative to the smallest diameter, same ratio as the
+// spatial hash used for equal sizes
+const float HIERARCHY_CELL_SCALE = 1.5f;
+
+void HierarchicalGrid::SetRadii(const float* radii, float defaultRadius)
+{
+    m_Radii = radii;
+    m_DefaultRadius = defaultRadius;
+}
+
+void HierarchicalGrid::Update(const std::vector<Particle>& particles)
+{
+    const int N = static_cast<int>(particles.size());
+
+    // The smallest particle sets the finest level, rebuild the levels when it changes
+    float minRadius = m_DefaultRadius;
+    if (m_Radii && N > 0)
+        minRadius = *std::min_element(m_Radii, m_Radii + N);
+
+    const float baseCellSize = HIERARCHY_CELL_SCALE * 2.0f * minRadius;
+    if (baseCellSize != m_BaseCellSize)
+    {
+        m_Levels.clear();
+        m_BaseCellSize = baseCellSize;
+    }
+
+    for (auto& level : m_Levels)
+    {
+        level.particles.clear();
+        level.maxRadius = 0.0f;
+    }
+
+    // Smallest level whose cells are at least the particle's diameter
+    for (int i = 0; i < N; i++)
+    {
+        const float radius = GetRadius(i);
+        const float diameter = 2.0f * radius;
+
+        int levelIndex = 0;
+        float cellSize = m_BaseCellSize;
+        while (cellSize < diameter)
+        {
+            cellSize *= 2.0f;
+            levelIndex++;
+        }
+
+        while (levelIndex >= static_cast<int>(m_Levels.size()))
+            m_Levels.emplace_back(m_BaseCellSize * std::ldexp(1.0f, static_cast<int>(m_Levels.size())));
+
+        Level& level = m_Levels[levelIndex];
+        level.particles.push_back(i);
+        level.maxRadius = std::max(level.maxRadius, radius);
+    }
+
+    for (auto& level : m_Levels)
+        level.hash.Update(particles, level.particles);
+}
+
+std::vector<std::pair<int, int>>& HierarchicalGrid::GetPotentialCollisionPairs(
+    const std::vector<Particle>& particles,
+    float)
+{
+    m_CollisionPairs.clear();
+    m_CollisionPairs.reserve(particles.size() * 3);
+
+    const int levelCount = static_cast<int>(m_Levels.size());
+    for (int fine = 0; fine < levelCount; fine++)
+    {
+        Level& level = m_Levels[fine];
+        if (level.particles.empty()) continue;
+
+        // Inside a level no contact is longer than twice its largest radius
+        const auto& levelPairs = level.hash.GetPotentialCollisionPairs(particles, 2.0f * level.maxRadius);
+        m_CollisionPairs.insert(m_CollisionPairs.end(), levelPairs.begin(), levelPairs.end());
+
+        // Upward only, the coarser level never looks back down
+        for (int coarse = fine + 1; coarse < levelCount; coarse++)
+        {
+            const SpatialHash& coarseHash = m_Levels[coarse].hash;
+            if (m_Levels[coarse].particles.empty()) continue;
+            const float coarseMaxRadius = m_Levels[coarse].maxRadius;
+
+            for (const int index : level.particles)
+            {
+                const Vec2& position = particles[index].position;
+                const float radius = GetRadius(index);
+
+                // Cells within reach of the largest particle of that level, at most 3x3
+                const float reach = radius + coarseMaxRadius;
+                const int minX = coarseHash.GetCoord(position.x - reach);
+                const int maxX = coarseHash.GetCoord(position.x + reach);
+                const int minY = coarseHash.GetCoord(position.y - reach);
+                const int maxY = coarseHash.GetCoord(position.y + reach);
+
+                for (int y = minY; y <= maxY; y++)
+                {
+                    for (int x = minX; x <= maxX; x++)
+                    {
+                        int count;
+                        const int* cellParticles = coarseHash.GetCellParticles(x, y, count);
+                        for (int k = 0; k < count; k++)
+                        {
+                            const int other = cellParticles[k];
+                            const float contact = radius + GetRadius(other);
+                            const float dx = position.x - particles[other].position.x;
+                            const float dy = position.y - particles[other].position.y;
+                            if (dx * dx + dy * dy <= contact * contact)
+                                m_CollisionPairs.emplace_back(index, other);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return m_CollisionPairs;
+}
+
+float HierarchicalGrid::GetMeanOccupancy() const
+{
+    double sharedSum = 0.0;
+    size_t count = 0;
+    for (const auto& level : m_Levels)
+    {
+        sharedSum += static_cast<double>(level.hash.GetMeanOccupancy()) * level.particles.size();
+        count += level.particles.size();
+    }
+    return count > 0 ? static_cast<float>(sharedSum / count) : 0.0f;
+}
+
+float HierarchicalGrid::GetMeanUpwardLevels() const
+{
+    double upwardSum = 0.0;
+    size_t count = 0;
+    int nonEmptyAbove = 0;
+    for (int level = static_cast<int>(m_Levels.size()) - 1; level >= 0; level--)
+    {
+        const size_t levelCount = m_Levels[level].particles.size();
+        upwardSum += static_cast<double>(levelCount) * nonEmptyAbove;
+        count += levelCount;
+        if (levelCount > 0)
+            nonEmptyAbove++;
+    }
+    return count > 0 ? static_cast<float>(upwardSum / count) : 0.0f;
+}
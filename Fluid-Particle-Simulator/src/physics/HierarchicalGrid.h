@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include "Broadphase.h"
+#include "SpatialHash.h"
+
+// Broadphase for particles of different sizes. A single grid needs cells as large as the
+// biggest contact distance, with a 10x size spread every small particle would then share
+// its cell with dozens of others. Here each particle is binned in the level whose cells
+// just fit its diameter, level k has cells of HIERARCHY_CELL_SCALE * smallest diameter * 2^k.
+//
+// Pairs inside a level come from that level's hash. Across levels a particle only looks
+// up into the coarser ones, in the 3x3 cells around it: a larger neighbour's center is
+// at most ra + rb <= its own cell size away. Every pair is found once, from the smaller
+// particle. Levels are sparse hashes so unused levels and unbounded domains cost nothing
+class HierarchicalGrid : public Broadphase {
+private:
+    struct Level {
+        SpatialHash hash;
+        std::vector<int> particles;  // indices of the particles binned in this level
+        float maxRadius = 0.0f;
+
+        explicit Level(float cellSize) : hash(cellSize) {}
+    };
+
+    std::vector<Level> m_Levels;
+    float m_BaseCellSize = 0.0f;
+    std::vector<std::pair<int, int>> m_CollisionPairs;
+
+    const float* m_Radii = nullptr;
+    float m_DefaultRadius = 1.0f;
+
+    inline float GetRadius(int index) const { return m_Radii ? m_Radii[index] : m_DefaultRadius; }
+
+public:
+    // Radii of the particles, null when they all have defaultRadius. The array is read
+    // by Update and GetPotentialCollisionPairs, it has to outlive them
+    void SetRadii(const float* radii, float defaultRadius);
+
+    void Update(const std::vector<Particle>& particles) override;
+
+    // maxDistance is ignored, every pair is tested against the sum of its radii
+    std::vector<std::pair<int, int>>& GetPotentialCollisionPairs(
+        const std::vector<Particle>& particles,
+        float maxDistance) override;
+
+    const char* GetName() const override { return "Hierarchical grid"; }
+
+    int GetLevelCount() const { return static_cast<int>(m_Levels.size()); }
+    float GetLevelCellSize(int level) const { return m_Levels[level].hash.GetCellSize(); }
+    int GetLevelParticleCount(int level) const { return static_cast<int>(m_Levels[level].particles.size()); }
+
+    // Average number of particles sharing a cell with a particle, in its own level
+    float GetMeanOccupancy() const;
+
+    // Average number of coarser (non empty) levels a particle looks up into
+    float GetMeanUpwardLevels() const;
+};
@@ -0,0 +1,28 @@
+#include "JacobiSolver.h"
+#include <algorithm>
+
+void JacobiSolver::BuildGather(int particleCount, const PairList& pairs, FrameArena& arena)
+{
+    const int pairCount = pairs.count;
+
+    // Count the pairs of every particle, the prefix sum gives the ranges
+    m_GatherStart = arena.Allocate<int>(particleCount + 1);
+    std::fill(m_GatherStart, m_GatherStart + particleCount + 1, 0);
+    for (const auto& pair : pairs)
+    {
+        m_GatherStart[pair.first + 1]++;
+        m_GatherStart[pair.second + 1]++;
+    }
+    for (int i = 0; i < particleCount; i++)
+        m_GatherStart[i + 1] += m_GatherStart[i];
+
+    // Fill in pair order so every particle sums its pairs in that order
+    int* cursor = arena.Allocate<int>(particleCount);
+    std::copy(m_GatherStart, m_GatherStart + particleCount, cursor);
+    m_GatherSlots = arena.Allocate<int>(2 * pairCount);
+    for (int k = 0; k < pairCount; k++)
+    {
+        m_GatherSlots[cursor[pairs[k].first]++] = 2 * k;
+        m_GatherSlots[cursor[pairs[k].second]++] = 2 * k + 1;
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "StepPolicies.h"
+#include "../core/ThreadPool.h"
+
+// Jacobi contact solver. Every pair is solved against the state at the start of the
+// pass and writes its corrections to its own slots, then every particle gathers the
+// corrections of its pairs and applies them. Both passes run in parallel without
+// atomics: a pair only writes its slots and a particle only writes itself.
+//
+// The gather goes through a CSR index (pair slots of each particle, in pair order),
+// so the sums always add up in the same order and the result doesn't depend on the
+// thread count. Position corrections are averaged over the contacts of a particle,
+// summing them would overshoot when a particle is squeezed from several sides. For
+// the same reason the impulse of a pair is divided by the contact count of the more
+// crowded of its two particles, both get the same share so momentum is kept, and a
+// resting pile doesn't pump energy into itself.
+//
+// The buffers are taken from the step arena, they only point somewhere during Solve
+class JacobiSolver {
+private:
+    // Slot 2k is pair k seen from its first particle, 2k + 1 from the second
+    Vec2* m_PositionDeltas = nullptr;
+    Vec2* m_VelocityDeltas = nullptr;
+    float* m_Impulses = nullptr;
+    unsigned char* m_Touching = nullptr;
+    int* m_ContactCounts = nullptr;
+
+    int* m_GatherStart = nullptr;  // N + 1 offsets into m_GatherSlots
+    int* m_GatherSlots = nullptr;
+
+    // Build the pair slots of every particle, O(N + pairs)
+    void BuildGather(int particleCount, const PairList& pairs, FrameArena& arena);
+
+public:
+    template <class MassPolicy, class RadiusPolicy, class ThermalPolicy>
+    void Solve(std::vector<Particle>& particles, const PairList& pairs, FrameArena& arena,
+        const MassPolicy& mass, const RadiusPolicy& radius, const ThermalPolicy& thermal);
+};
+
+// Chunks small enough to balance, large enough to hide the dispatch
+const int JACOBI_MIN_CHUNK = 2048;
+
+template <class MassPolicy, class RadiusPolicy, class ThermalPolicy>
+void JacobiSolver::Solve(std::vector<Particle>& particles, const PairList& pairs, FrameArena& arena,
+    const MassPolicy& mass, const RadiusPolicy& radius, const ThermalPolicy& thermal)
+{
+    const int N = static_cast<int>(particles.size());
+    const int pairCount = pairs.count;
+    if (pairCount == 0)
+        return;
+
+    BuildGather(N, pairs, arena);
+    m_PositionDeltas = arena.Allocate<Vec2>(2 * pairCount);
+    m_VelocityDeltas = arena.Allocate<Vec2>(2 * pairCount);
+    m_Touching = arena.Allocate<unsigned char>(pairCount);
+    m_ContactCounts = arena.Allocate<int>(N);
+    if (ThermalPolicy::Enabled)
+        m_Impulses = arena.Allocate<float>(pairCount);
+
+    ThreadPool& pool = ThreadPool::Get();
+
+    // Solve every pair from the same state
+    pool.ParallelFor(0, pairCount, [&](int begin, int end, int)
+    {
+        for (int k = begin; k < end; k++)
+        {
+            const int indexA = pairs[k].first;
+            const int indexB = pairs[k].second;
+
+            Contact contact{};
+            m_Touching[k] = ComputeContact(particles[indexA], particles[indexB], indexA, indexB, mass, radius, contact);
+            if (!m_Touching[k])
+                continue;
+
+            m_PositionDeltas[2 * k] = Vec2(contact.nx * contact.overlap * contact.ratioA,
+                                           contact.ny * contact.overlap * contact.ratioA);
+            m_PositionDeltas[2 * k + 1] = Vec2(-contact.nx * contact.overlap * contact.ratioB,
+                                               -contact.ny * contact.overlap * contact.ratioB);
+
+            if (contact.approaching)
+            {
+                m_VelocityDeltas[2 * k] = Vec2(contact.factorA * contact.nx, contact.factorA * contact.ny);
+                m_VelocityDeltas[2 * k + 1] = Vec2(-contact.factorB * contact.nx, -contact.factorB * contact.ny);
+                if (ThermalPolicy::Enabled)
+                    m_Impulses[k] = mass.Impulse(indexA, indexB, contact.impulseScalar);
+            }
+            else
+            {
+                m_VelocityDeltas[2 * k] = Vec2(0.0f, 0.0f);
+                m_VelocityDeltas[2 * k + 1] = Vec2(0.0f, 0.0f);
+                if (ThermalPolicy::Enabled)
+                    m_Impulses[k] = 0.0f;
+            }
+        }
+    }, JACOBI_MIN_CHUNK);
+
+    // Touching pairs of every particle
+    pool.ParallelFor(0, N, [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            int contacts = 0;
+            for (int s = m_GatherStart[i]; s < m_GatherStart[i + 1]; s++)
+                contacts += m_Touching[m_GatherSlots[s] >> 1];
+            m_ContactCounts[i] = contacts;
+        }
+    }, JACOBI_MIN_CHUNK);
+
+    // Gather and apply, always in pair order
+    pool.ParallelFor(0, N, [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            Vec2 positionDelta(0.0f, 0.0f);
+            Vec2 velocityDelta(0.0f, 0.0f);
+            float impulse = 0.0f;
+            const int contacts = m_ContactCounts[i];
+            if (contacts == 0)
+                continue;
+
+            for (int s = m_GatherStart[i]; s < m_GatherStart[i + 1]; s++)
+            {
+                const int slot = m_GatherSlots[s];
+                const int k = slot >> 1;
+                if (!m_Touching[k]) continue;
+
+                const int other = (slot & 1) ? pairs[k].first : pairs[k].second;
+                const float share = 1.0f / std::max(contacts, m_ContactCounts[other]);
+                positionDelta += m_PositionDeltas[slot];
+                velocityDelta += m_VelocityDeltas[slot] * share;
+                if (ThermalPolicy::Enabled)
+                    impulse += m_Impulses[k] * share;
+            }
+
+            particles[i].position += positionDelta * (1.0f / contacts);
+            particles[i].velocity += velocityDelta;
+            thermal.Heat(i, impulse);
+        }
+    }, JACOBI_MIN_CHUNK);
+}
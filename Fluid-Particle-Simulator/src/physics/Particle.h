@@ -3,20 +3,15 @@
 #include "glm/glm.hpp"
 #include "Vec2.h"
 
+// Hot kinematic state only, read and written by every substep. Mass, temperature and
+// the other optional per-particle data are stored in ParticleAttributes
 struct Particle
 {
 	Vec2 position;
 	Vec2 velocity;
-	Vec2 force; // the same as acceleration
-	float mass;
 
-	float temperature;
-	float density;   // ?
-	float pressure;  // ?
-
-	Particle(const Vec2& pos, const Vec2& vel, float m = 1.0f)
-		: position(pos), velocity(vel), force({0.0, 0.0}),
-		density(0.0f), pressure(0.0f), mass(m), temperature(20.0f)
+	Particle(const Vec2& pos, const Vec2& vel)
+		: position(pos), velocity(vel)
 	{
 	}
 };
\ No newline at end of file
@@ -0,0 +1,176 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+// Optional per-particle data. Particle only holds the hot kinematic state (position
+// and velocity) touched every substep, everything else lives in separate columns
+// indexed like the particle vector. A column is only allocated once the simulation
+// declares the channel, so pure collision runs don't carry (or stream) any of it
+enum class ParticleChannel : unsigned int {
+    Mass,          // per-particle mass, only needed when masses differ
+    Radius,        // per-particle radius, only needed when sizes differ
+    Temperature,   // speed and collision heating
+    Sleep,         // rest detection (rest step counter + sleeping flag)
+    Count
+};
+
+// Temperature every particle starts at and cools down to
+const float AMBIENT_TEMPERATURE = 20.0f;
+
+class ParticleAttributes {
+private:
+    unsigned int m_Declared = 0;
+    size_t m_Size = 0;
+    size_t m_Capacity = 0;   // from Reserve, channels declared later get it too
+    float m_DefaultMass = 1.0f;
+    float m_DefaultRadius = 1.0f;
+
+    std::vector<float> m_Mass;
+    std::vector<float> m_Radius;
+    std::vector<float> m_Temperature;
+    std::vector<int> m_RestSteps;
+    std::vector<unsigned char> m_Sleeping;
+
+    static unsigned int Bit(ParticleChannel channel) { return 1u << static_cast<unsigned int>(channel); }
+
+public:
+    bool Has(ParticleChannel channel) const { return (m_Declared & Bit(channel)) != 0; }
+
+    // Allocate a channel for every existing particle, filled with its default value
+    void Declare(ParticleChannel channel)
+    {
+        if (Has(channel)) return;
+        m_Declared |= Bit(channel);
+
+        switch (channel)
+        {
+        case ParticleChannel::Mass:
+            m_Mass.reserve(m_Capacity);
+            m_Mass.assign(m_Size, m_DefaultMass);
+            break;
+        case ParticleChannel::Radius:
+            m_Radius.reserve(m_Capacity);
+            m_Radius.assign(m_Size, m_DefaultRadius);
+            break;
+        case ParticleChannel::Temperature:
+            m_Temperature.reserve(m_Capacity);
+            m_Temperature.assign(m_Size, AMBIENT_TEMPERATURE);
+            break;
+        case ParticleChannel::Sleep:
+            m_RestSteps.reserve(m_Capacity);
+            m_Sleeping.reserve(m_Capacity);
+            m_RestSteps.assign(m_Size, 0);
+            m_Sleeping.assign(m_Size, 0);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Drop a channel and give its memory back
+    void Release(ParticleChannel channel)
+    {
+        m_Declared &= ~Bit(channel);
+
+        switch (channel)
+        {
+        case ParticleChannel::Mass:
+            std::vector<float>().swap(m_Mass);
+            break;
+        case ParticleChannel::Radius:
+            std::vector<float>().swap(m_Radius);
+            break;
+        case ParticleChannel::Temperature:
+            std::vector<float>().swap(m_Temperature);
+            break;
+        case ParticleChannel::Sleep:
+            std::vector<int>().swap(m_RestSteps);
+            std::vector<unsigned char>().swap(m_Sleeping);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Mass given to existing particles when the mass channel gets declared
+    void SetDefaultMass(float mass) { m_DefaultMass = mass; }
+
+    // Radius given to existing particles when the radius channel gets declared
+    void SetDefaultRadius(float radius) { m_DefaultRadius = radius; }
+
+    // Append the cold data of count new particles to every declared channel
+    void Append(size_t count, float mass, float radius)
+    {
+        m_Size += count;
+        if (Has(ParticleChannel::Mass)) m_Mass.resize(m_Size, mass);
+        if (Has(ParticleChannel::Radius)) m_Radius.resize(m_Size, radius);
+        if (Has(ParticleChannel::Temperature)) m_Temperature.resize(m_Size, AMBIENT_TEMPERATURE);
+        if (Has(ParticleChannel::Sleep)) {
+            m_RestSteps.resize(m_Size, 0);
+            m_Sleeping.resize(m_Size, 0);
+        }
+    }
+
+    // Copy the data of particle from over particle to (swap-remove compaction)
+    void Move(size_t from, size_t to)
+    {
+        if (Has(ParticleChannel::Mass)) m_Mass[to] = m_Mass[from];
+        if (Has(ParticleChannel::Radius)) m_Radius[to] = m_Radius[from];
+        if (Has(ParticleChannel::Temperature)) m_Temperature[to] = m_Temperature[from];
+        if (Has(ParticleChannel::Sleep)) {
+            m_RestSteps[to] = m_RestSteps[from];
+            m_Sleeping[to] = m_Sleeping[from];
+        }
+    }
+
+    // Drop every particle from index size on, capacity is kept
+    void Truncate(size_t size)
+    {
+        m_Size = std::min(m_Size, size);
+        if (Has(ParticleChannel::Mass)) m_Mass.resize(m_Size);
+        if (Has(ParticleChannel::Radius)) m_Radius.resize(m_Size);
+        if (Has(ParticleChannel::Temperature)) m_Temperature.resize(m_Size);
+        if (Has(ParticleChannel::Sleep)) {
+            m_RestSteps.resize(m_Size);
+            m_Sleeping.resize(m_Size);
+        }
+    }
+
+    void Reserve(size_t count)
+    {
+        m_Capacity = std::max(m_Capacity, count);
+        if (Has(ParticleChannel::Mass)) m_Mass.reserve(count);
+        if (Has(ParticleChannel::Radius)) m_Radius.reserve(count);
+        if (Has(ParticleChannel::Temperature)) m_Temperature.reserve(count);
+        if (Has(ParticleChannel::Sleep)) {
+            m_RestSteps.reserve(count);
+            m_Sleeping.reserve(count);
+        }
+    }
+
+    size_t GetSize() const { return m_Size; }
+
+    // Bytes of cold data stored per particle with the current channels
+    size_t GetBytesPerParticle() const
+    {
+        size_t bytes = 0;
+        if (Has(ParticleChannel::Mass)) bytes += sizeof(float);
+        if (Has(ParticleChannel::Radius)) bytes += sizeof(float);
+        if (Has(ParticleChannel::Temperature)) bytes += sizeof(float);
+        if (Has(ParticleChannel::Sleep)) bytes += sizeof(int) + sizeof(unsigned char);
+        return bytes;
+    }
+
+    // Column access, the vectors are empty when the channel isn't declared
+    std::vector<float>& GetMass() { return m_Mass; }
+    const std::vector<float>& GetMass() const { return m_Mass; }
+    std::vector<float>& GetRadius() { return m_Radius; }
+    const std::vector<float>& GetRadius() const { return m_Radius; }
+    std::vector<float>& GetTemperature() { return m_Temperature; }
+    const std::vector<float>& GetTemperature() const { return m_Temperature; }
+    std::vector<int>& GetRestSteps() { return m_RestSteps; }
+    const std::vector<int>& GetRestSteps() const { return m_RestSteps; }
+    std::vector<unsigned char>& GetSleeping() { return m_Sleeping; }
+    const std::vector<unsigned char>& GetSleeping() const { return m_Sleeping; }
+};
@@ -1,86 +1,733 @@
 #include "physics.h"
 #include "SpatialGrid.h"
+#include "StepPolicies.h"
+#include "TiledAllPairs.h"
+#include "SweepAndPrune.h"
+#include "SpatialHash.h"
+#include "HierarchicalGrid.h"
+#include "JacobiSolver.h"
+#include "../core/ThreadPool.h"
+#include <cmath>
+#include <limits>
  
 
 const Vec2 G(0.0f, -20.80665f);
 const float AIR_RESISTANCE = 0.0f;
 
-void UpdatePhysics(SimulationSystem& sim, float deltaTime, bool useSpacePart)
+// Maximum number of impacts handled for a fast particle in a single step
+const int MAX_CCD_ITERATIONS = 4;
+
+// Room reserved for the neighbours found around a swept particle, fast particles are
+// rare and the first one would otherwise grow the list in the middle of a run
+const int CCD_CANDIDATE_CAPACITY = 256;
+
+// Auto broadphase: the choice is re-evaluated every AUTO_BROADPHASE_INTERVAL steps by
+// comparing estimated costs (nanoseconds, fitted on the broadphase benchmark scenes).
+// All pairs costs a fixed amount per pair, the grid pays for every cell it scans and
+// for the particles sharing a cell, which grows when particles pile up. Sweep and
+// prune pays for every particle in the active list, the ones in the same x column.
+// The hash pays more per particle than the grid (lookups) but nothing for empty space,
+// the hierarchical grid pays one hash per level and the lookups in every coarser level
+const int AUTO_BROADPHASE_INTERVAL = 30;
+const float COST_ALL_PAIRS_PAIR = 0.55f;
+const float COST_GRID_CELL = 6.0f;
+const float COST_GRID_PARTICLE = 20.0f;
+const float COST_GRID_OCCUPANCY = 40.0f;
+const float COST_SAP_PARTICLE = 20.0f;
+const float COST_SAP_ACTIVE = 1.5f;
+const float COST_HASH_PARTICLE = 90.0f;
+const float COST_HASH_OCCUPANCY = 15.0f;
+const float COST_HIERARCHY_PARTICLE = 150.0f;
+const float COST_HIERARCHY_UPWARD = 60.0f;
+
+// Acceleration structures and solver buffers kept alive between steps
+struct BroadphaseResources
 {
-    std::vector<Particle>& particles = sim.GetParticles();
-    const int N = particles.size();
+    SpatialGrid grid;
+    TiledAllPairs allPairs;
+    SweepAndPrune sweepAndPrune;
+    SpatialHash hash;
+    HierarchicalGrid hierarchy;
+    JacobiSolver jacobi;
 
-    for (int i = 0; i < N; i++)
+    // Neighbours of the particle being swept
+    std::vector<int> ccdCandidates;
+
+    int stepsUntilEvaluation = 0;
+    BroadphaseType autoChoice = BroadphaseType::UniformGrid;
+
+    // What the grid and the hash were sized for
+    Bounds fittedBounds;
+    float fittedRadius;
+
+    BroadphaseResources(const SimulationSystem& sim)
+        : grid(sim.GetBounds().bottomLeft, sim.GetBounds().topRight,
+            2.1f * 2.0f * sim.GetParticleRadius(), // Cell size (compute once)
+            static_cast<int>(sim.GetParticles().size())),
+        hash(1.5f * 2.0f * sim.GetParticleRadius()), // tighter cells are cheap without empty ones
+        fittedBounds(sim.GetBounds()), fittedRadius(sim.GetParticleRadius())
     {
-        Particle& particleA = particles[i];
+        ccdCandidates.reserve(CCD_CANDIDATE_CAPACITY);
+    }
 
-        // Force calculation
-        particleA.force.x = particleA.mass * G.x;
-        particleA.force.y = particleA.mass * G.y;
+    // Rebuild the grid and the hash when UpdatePhysics is handed a simulation with other
+    // bounds or another particle size (the benchmarks run one after the other)
+    void Fit(const SimulationSystem& sim)
+    {
+        const Bounds& bounds = sim.GetBounds();
+        if (bounds.bottomLeft == fittedBounds.bottomLeft && bounds.topRight == fittedBounds.topRight &&
+            sim.GetParticleRadius() == fittedRadius)
+            return;
 
-        // Air resistance
-        particleA.force.x -= particleA.velocity.x * AIR_RESISTANCE;
-        particleA.force.y -= particleA.velocity.y * AIR_RESISTANCE;
+        grid = SpatialGrid(bounds.bottomLeft, bounds.topRight, 2.1f * 2.0f * sim.GetParticleRadius(),
+            static_cast<int>(sim.GetParticles().size()));
+        hash = SpatialHash(1.5f * 2.0f * sim.GetParticleRadius());
+        fittedBounds = bounds;
+        fittedRadius = sim.GetParticleRadius();
+        stepsUntilEvaluation = 0;
+    }
 
-        // Velocity integration
-        particleA.velocity.x += (particleA.force.x / particleA.mass) * deltaTime;
-        particleA.velocity.y += (particleA.force.y / particleA.mass) * deltaTime;
+    Broadphase& Get(BroadphaseType type)
+    {
+        switch (type)
+        {
+        case BroadphaseType::AllPairs: return allPairs;
+        case BroadphaseType::SweepAndPrune: return sweepAndPrune;
+        case BroadphaseType::SpatialHash: return hash;
+        case BroadphaseType::HierarchicalGrid: return hierarchy;
+        default: return grid;
+        }
+    }
+};
 
-        // Position integration
-        particleA.position.x += particleA.velocity.x * deltaTime;
-        particleA.position.y += particleA.velocity.y * deltaTime;
+FrameArena& GetStepArena()
+{
+    static FrameArena arena;
+    return arena;
+}
 
-        // Temperature calculation
-        const float speed = particleA.velocity.length();
-        if (speed > 5.0f) 
+static uint64_t& StepCount()
+{
+    static uint64_t count = 0;
+    return count;
+}
+
+uint64_t GetPhysicsStepCount()
+{
+    return StepCount();
+}
+
+static const Broadphase*& ActiveBroadphase()
+{
+    static const Broadphase* broadphase = nullptr;
+    return broadphase;
+}
+
+const char* GetActiveBroadphaseName()
+{
+    return ActiveBroadphase() ? ActiveBroadphase()->GetName() : "none";
+}
+
+// Decide which grid cells sleep. A cell sleeps when every particle in it and in its
+// 8 neighbour cells is at rest, so anything moving nearby keeps (or wakes) it up
+static void UpdateSleepingCells(SpatialGrid& grid, std::vector<Particle>& particles, const StepContext& ctx)
+{
+    const int width = grid.GetGridWidth();
+    const int height = grid.GetGridHeight();
+    const int cellCount = grid.GetCellCount();
+
+    unsigned char* canSleep = ctx.arena->Allocate<unsigned char>(cellCount);
+    std::fill(canSleep, canSleep + cellCount, static_cast<unsigned char>(1));
+
+    // Every cell holding an active particle keeps its neighbourhood awake
+    grid.ForEachOccupiedCell([&](int x, int y, int cell)
+    {
+        for (const int index : grid.GetCell(cell))
+        {
+            if (ctx.restSteps[index] >= ctx.sleepSteps) continue;
+
+            for (int ny = std::max(0, y - 1); ny <= std::min(height - 1, y + 1); ++ny)
+                for (int nx = std::max(0, x - 1); nx <= std::min(width - 1, x + 1); ++nx)
+                    canSleep[nx + ny * width] = 0;
+            break;
+        }
+    });
+
+    // Empty cells never sleep
+    grid.WakeAllCells();
+    grid.ForEachOccupiedCell([&](int, int, int cell)
+    {
+        const bool asleep = canSleep[cell] != 0;
+        grid.SetCellAsleep(cell, asleep);
+
+        for (const int index : grid.GetCell(cell))
         {
-            particleA.temperature = std::min(100.0f, particleA.temperature + 0.1f);
+            if (asleep && !ctx.sleeping[index])
+                particles[index].velocity = { 0.0f, 0.0f };
+            ctx.sleeping[index] = asleep;
         }
-        else 
+    });
+}
+
+// Move a fast particle through deltaTime stopping at every time of impact against the
+// borders and the particles stored in the grid or hash (treated as static for this step)
+template <class SpatialIndex, class MassPolicy, class RadiusPolicy, class ThermalPolicy>
+static void SweepParticle(int index, std::vector<Particle>& particles, SpatialIndex& spatialIndex,
+    std::vector<int>& candidates, const MassPolicy& mass, const RadiusPolicy& radius,
+    const ThermalPolicy& thermal, const StepContext& ctx)
+{
+    const Bounds& bounds = ctx.bounds;
+    const float particleRadius = radius.Radius(index);
+    const float deltaTime = ctx.deltaTime;
+
+    Particle& particle = particles[index];
+
+    // Farthest a neighbour's center can be when touching
+    const float reach = particleRadius + ctx.maxRadius;
+
+    const Vec2 startPosition = particle.position;
+
+    float remaining = deltaTime;
+    for (int iteration = 0; iteration < MAX_CCD_ITERATIONS && remaining > 0.0f; iteration++)
+    {
+        const Vec2 start = particle.position;
+        const Vec2 motion = particle.velocity * remaining;
+
+        // Swept AABB of the circle grown by the reach to catch every neighbour it can touch
+        const Vec2 minCorner(std::min(start.x, start.x + motion.x) - reach,
+                             std::min(start.y, start.y + motion.y) - reach);
+        const Vec2 maxCorner(std::max(start.x, start.x + motion.x) + reach,
+                             std::max(start.y, start.y + motion.y) + reach);
+        candidates.clear();
+        spatialIndex.QueryAABB(minCorner, maxCorner, candidates);
+
+        // Earliest time of impact as a fraction of the remaining motion
+        float toi = 1.0f;
+        int hit = -1;
+        bool hitWallX = false;
+        bool hitWallY = false;
+
+        if (ctx.useBorders)
         {
-            particleA.temperature = std::max(20.0f, particleA.temperature - 0.05f);
+            if (motion.x > 0.0f && start.x + motion.x > bounds.topRight.x - particleRadius)
+            {
+                toi = std::max(0.0f, (bounds.topRight.x - particleRadius - start.x) / motion.x);
+                hitWallX = true;
+            }
+            else if (motion.x < 0.0f && start.x + motion.x < bounds.bottomLeft.x + particleRadius)
+            {
+                toi = std::max(0.0f, (bounds.bottomLeft.x + particleRadius - start.x) / motion.x);
+                hitWallX = true;
+            }
+
+            if (motion.y > 0.0f && start.y + motion.y > bounds.topRight.y - particleRadius)
+            {
+                const float t = std::max(0.0f, (bounds.topRight.y - particleRadius - start.y) / motion.y);
+                if (t < toi) { toi = t; hitWallX = false; hitWallY = true; }
+            }
+            else if (motion.y < 0.0f && start.y + motion.y < bounds.bottomLeft.y + particleRadius)
+            {
+                const float t = std::max(0.0f, (bounds.bottomLeft.y + particleRadius - start.y) / motion.y);
+                if (t < toi) { toi = t; hitWallX = false; hitWallY = true; }
+            }
         }
 
-        SolveCollisionBorder(particleA, sim.GetBounds(), sim.GetParticleRadius());
-        
-        // Choose if using or not space partitioning 
-        if (!useSpacePart) 
+        // Moving circle against static circles grown by its radius
+        const float a = motion.length_sq();
+        for (const int j : candidates)
         {
-            for (int j = 0; j < N; j++)
+            if (j == index) continue;
+
+            const float dx = start.x - particles[j].position.x;
+            const float dy = start.y - particles[j].position.y;
+            const float b = dx * motion.x + dy * motion.y;
+            if (b >= 0.0f) continue; // moving apart
+
+            const float c = dx * dx + dy * dy - radius.ContactDistanceSq(index, j);
+            if (c < 0.0f) continue; // already overlapping, left to the narrowphase
+
+            const float discriminant = b * b - a * c;
+            if (discriminant < 0.0f) continue;
+
+            const float t = (-b - std::sqrt(discriminant)) / a;
+            if (t >= 0.0f && t < toi)
             {
-                if (j != i)
-                {
-                    Particle& particleB = particles[j];
-                    SolveCollisionParticle(particleA, particleB, sim.GetBounds(), sim.GetParticleRadius());
-                }
+                toi = t;
+                hit = j;
+                hitWallX = false;
+                hitWallY = false;
             }
         }
+
+        particle.position += motion * toi;
+        remaining *= (1.0f - toi);
+
+        if (hit >= 0)
+        {
+            const float impulse = SolveImpactParticle(particle, particles[hit],
+                1.0f / mass.InvMass(index), 1.0f / mass.InvMass(hit));
+            thermal.Collision(index, hit, impulse);
+        }
+        else if (hitWallX)
+            particle.velocity.x = -particle.velocity.x;
+        else if (hitWallY)
+            particle.velocity.y = -particle.velocity.y;
+        else
+            break;
     }
-    if (useSpacePart)
+
+    // Out of iterations, finish the step normally
+    if (remaining > 0.0f)
+        particle.position += particle.velocity * remaining;
+    if (ctx.useBorders)
+        SolveCollisionBorder(particle, bounds, particleRadius);
+
+    // Keep the grid consistent for the narrowphase
+    spatialIndex.MoveParticle(index, startPosition, particle.position);
+}
+
+// Deterministic mode: keep only the pairs touching right now, as (lower index, higher
+// index) sorted on both. Every broadphase returns all touching pairs (sleeping is off in
+// this mode), so the solver sees the same list whichever one ran and in whatever order
+// its cells produced them
+template <class RadiusPolicy>
+static PairList CanonicalizePairs(const std::vector<std::pair<int, int>>& pairs,
+    const std::vector<Particle>& particles, const RadiusPolicy& radius, FrameArena& arena)
+{
+    std::pair<int, int>* touching = arena.Allocate<std::pair<int, int>>(pairs.size());
+    int touchingCount = 0;
+    for (const auto& pair : pairs)
     {
-        static SpatialGrid grid(
-            sim.GetBounds().bottomLeft,
-            sim.GetBounds().topRight,
-            2.1f * 2.0f * sim.GetParticleRadius(), // Cell size (compute once)
-            N
-        );
+        const int a = std::min(pair.first, pair.second);
+        const int b = std::max(pair.first, pair.second);
+        if ((particles[a].position - particles[b].position).length_sq() < radius.ContactDistanceSq(a, b))
+            touching[touchingCount++] = std::make_pair(a, b);
+    }
+
+    // Counting sort on the lower index, then the short buckets on the higher one
+    const int N = static_cast<int>(particles.size());
+    int* bucketEnd = arena.Allocate<int>(N + 1);
+    std::fill(bucketEnd, bucketEnd + N + 1, 0);
+    for (int k = 0; k < touchingCount; k++)
+        bucketEnd[touching[k].first + 1]++;
+    for (int i = 0; i < N; i++)
+        bucketEnd[i + 1] += bucketEnd[i];
+
+    std::pair<int, int>* canonical = arena.Allocate<std::pair<int, int>>(touchingCount);
+    for (int k = 0; k < touchingCount; k++)
+        canonical[bucketEnd[touching[k].first]++] = touching[k];
+
+    // bucketEnd[i] now holds the end of bucket i
+    int bucketBegin = 0;
+    for (int i = 0; i < N; i++)
+    {
+        if (bucketEnd[i] - bucketBegin > 1)
+            std::sort(canonical + bucketBegin, canonical + bucketEnd[i]);
+        bucketBegin = bucketEnd[i];
+    }
+    return { canonical, touchingCount };
+}
+
+static void UpdateGrid(SpatialGrid& grid, const std::vector<Particle>& particles, const StepContext& ctx)
+{
+    if (ctx.incrementalGrid)
+        grid.UpdateIncremental(particles);
+    else
+        grid.Update(particles);
+}
+
+// ---------- Step kernel ----------
 
-        grid.Clear();
+// End of a phase of the step, for the profiler
+static inline void LapPhase(const StepContext& ctx, StepPhase phase)
+{
+    if (ctx.profiler)
+        ctx.profiler->Lap(phase);
+}
+
+// One full substep, fully specialised on the policies. The broadphase is a runtime
+// choice, it's a single virtual call per step
+template <class Integrator, class MassPolicy, class RadiusPolicy, class ThermalPolicy>
+static void StepKernel(SimulationSystem& sim, BroadphaseResources& resources, const StepContext& ctx)
+{
+    SpatialGrid& grid = resources.grid;
+    Broadphase& broadphase = resources.Get(ctx.broadphase);
+    const bool usesGrid = &broadphase == &grid;
+    std::vector<Particle>& particles = sim.GetParticles();
+    const int N = static_cast<int>(particles.size());
+    const MassPolicy mass(ctx);
+    const RadiusPolicy radius(ctx);
+    const ThermalPolicy thermal(ctx);
+
+    // Particles moving too far in this step are integrated by SweepParticle instead
+    int* fastParticles = ctx.arena->Allocate<int>(N);
+    int fastCount = 0;
 
-        // Insert all particles into the reused grid
-        for (int i = 0; i < N; i++) {
-            grid.InsertParticle(i, particles[i].position);
+    for (int i = 0; i < N; i++)
+    {
+        Particle& particle = particles[i];
+
+        // Sleeping particles are frozen until an impulse from a neighbour wakes them up
+        if (ctx.useSleeping && ctx.sleeping[i])
+        {
+            if (particle.velocity.length_sq() <= ctx.sleepSpeedSq)
+                continue;
+
+            ctx.sleeping[i] = 0;
+            ctx.restSteps[i] = 0;
         }
 
-        // Get collision pairs and resolve collisions
-        std::vector<std::pair<int, int>> collisionPairs = grid.GetPotentialCollisionPairs(
-                                                                sim.GetParticles(),
-                                                                2 * sim.GetParticleRadius());
+        // Gravity and air resistance, recomputed every step so it isn't stored
+        const float invMass = mass.InvMass(i);
+        const Vec2 acceleration(
+            G.x - particle.velocity.x * AIR_RESISTANCE * invMass,
+            G.y - particle.velocity.y * AIR_RESISTANCE * invMass);
+
+        const Vec2 displacement = Integrator::Step(particle.velocity, acceleration, ctx.deltaTime);
+        const float speedSq = particle.velocity.length_sq();
+
+        if (ctx.useCCD && speedSq > ctx.ccdSpeedSq)
+            fastParticles[fastCount++] = i;
+        else
+            particle.position += displacement;
+
+        thermal.Integrate(i, speedSq);
+
+        // Count how long the particle has been at rest
+        if (ctx.useSleeping)
+        {
+            if (speedSq < ctx.sleepSpeedSq)
+                ctx.restSteps[i] = std::min(ctx.restSteps[i] + 1, ctx.sleepSteps);
+            else
+                ctx.restSteps[i] = 0;
+        }
+
+        if (ctx.useBorders)
+            SolveCollisionBorder(particle, ctx.bounds, radius.Radius(i));
+    }
+    LapPhase(ctx, StepPhase::Integrate);
+
+    // Sub-step only the fast particles against their neighbours, found through the
+    // grid or through the hash when there are no bounds to build the grid on
+    if (fastCount > 0)
+    {
+        if (ctx.useBorders)
+        {
+            UpdateGrid(grid, particles, ctx);
+            for (int k = 0; k < fastCount; k++)
+                SweepParticle(fastParticles[k], particles, grid, resources.ccdCandidates, mass, radius, thermal, ctx);
+        }
+        else
+        {
+            resources.hash.Update(particles);
+            for (int k = 0; k < fastCount; k++)
+                SweepParticle(fastParticles[k], particles, resources.hash, resources.ccdCandidates,
+                    mass, radius, thermal, ctx);
+        }
+    }
+    LapPhase(ctx, StepPhase::Sweep);
+
+    if (usesGrid)
+    {
+        // Already up to date if the sweep used it
+        if (fastCount == 0)
+            UpdateGrid(grid, particles, ctx);
+
+        // Put settled regions to sleep, their internal pairs are skipped
+        if (ctx.useSleeping)
+            UpdateSleepingCells(grid, particles, ctx);
+        else
+            grid.WakeAllCells();
+    }
+    else
+    {
+        broadphase.Update(particles);
+    }
+
+    // The renderer culls through the grid whenever it holds this step's particles
+    if (usesGrid || (fastCount > 0 && ctx.useBorders))
+        sim.SetCullingGrid(&grid, GetPhysicsStepCount());
+    LapPhase(ctx, StepPhase::Grid);
+
+    const auto& potentialPairs = broadphase.GetPotentialCollisionPairs(particles, ctx.pairDistance);
+    const PairList collisionPairs = ctx.deterministic
+        ? CanonicalizePairs(potentialPairs, particles, radius, *ctx.arena)
+        : PairList{ potentialPairs.data(), static_cast<int>(potentialPairs.size()) };
+    LapPhase(ctx, StepPhase::Pairs);
+
+    if (ctx.solver == SolverType::Jacobi)
+    {
+        resources.jacobi.Solve(particles, collisionPairs, *ctx.arena, mass, radius, thermal);
+    }
+    else
+    {
+        for (const auto& pair : collisionPairs)
+            SolvePair(particles, pair.first, pair.second, mass, radius, thermal);
+    }
+    LapPhase(ctx, StepPhase::Solve);
+
+    sim.UpdateStreams(ctx.deltaTime);
+    sim.UpdateEmitters(ctx.deltaTime);
+    LapPhase(ctx, StepPhase::Spawn);
+}
+
+// ---------- Runtime dispatch ----------
+
+typedef void (*StepKernelFunction)(SimulationSystem&, BroadphaseResources&, const StepContext&);
+
+template <class Integrator, class MassPolicy, class RadiusPolicy>
+static StepKernelFunction SelectThermal(bool temperature)
+{
+    if (temperature)
+        return &StepKernel<Integrator, MassPolicy, RadiusPolicy, TemperatureOn>;
+    return &StepKernel<Integrator, MassPolicy, RadiusPolicy, TemperatureOff>;
+}
+
+template <class Integrator, class MassPolicy>
+static StepKernelFunction SelectRadius(bool uniformRadius, bool temperature)
+{
+    if (uniformRadius)
+        return SelectThermal<Integrator, MassPolicy, UniformRadius>(temperature);
+    return SelectThermal<Integrator, MassPolicy, PerParticleRadius>(temperature);
+}
+
+template <class Integrator>
+static StepKernelFunction SelectMass(bool uniformMass, bool uniformRadius, bool temperature)
+{
+    if (uniformMass)
+        return SelectRadius<Integrator, UniformMass>(uniformRadius, temperature);
+    return SelectRadius<Integrator, PerParticleMass>(uniformRadius, temperature);
+}
+
+static StepKernelFunction SelectStepKernel(IntegratorType integrator, bool uniformMass,
+    bool uniformRadius, bool temperature)
+{
+    switch (integrator)
+    {
+    case IntegratorType::VelocityVerlet:
+        return SelectMass<VelocityVerlet>(uniformMass, uniformRadius, temperature);
+    case IntegratorType::SemiImplicitEuler:
+    default:
+        return SelectMass<SemiImplicitEuler>(uniformMass, uniformRadius, temperature);
+    }
+}
+
+// Pick the cheapest broadphase for the current scene. The densities are measured on
+// the structures themselves: the average number of particles sharing a grid (or hash)
+// cell with a particle, and the average length of the sweep and prune active list.
+// With different sizes the grid and the hash would need cells fitting the largest
+// particle, the hierarchical grid takes their place
+static BroadphaseType ChooseBroadphase(const std::vector<Particle>& particles, float maxDistance,
+    bool bounded, bool uniformRadius, BroadphaseResources& resources)
+{
+    if (--resources.stepsUntilEvaluation > 0)
+        return resources.autoChoice;
+    resources.stepsUntilEvaluation = AUTO_BROADPHASE_INTERVAL;
+
+    const double N = static_cast<double>(particles.size());
+
+    resources.sweepAndPrune.Update(particles);
+    const double activeLength = resources.sweepAndPrune.MeasureActiveLength(maxDistance);
+
+    const double allPairsCost = COST_ALL_PAIRS_PAIR * 0.5 * N * (N - 1.0);
+    const double sweepCost = N * (COST_SAP_PARTICLE + COST_SAP_ACTIVE * activeLength);
+
+    double bestCost;
+    if (uniformRadius)
+    {
+        resources.hash.Update(particles);
+        const double hashOccupancy = resources.hash.GetMeanOccupancy();
+        resources.autoChoice = BroadphaseType::SpatialHash;
+        bestCost = N * (COST_HASH_PARTICLE + COST_HASH_OCCUPANCY * hashOccupancy);
+    }
+    else
+    {
+        resources.hierarchy.Update(particles);
+        const double occupancy = resources.hierarchy.GetMeanOccupancy();
+        const double upward = resources.hierarchy.GetMeanUpwardLevels();
+        resources.autoChoice = BroadphaseType::HierarchicalGrid;
+        bestCost = N * (COST_HIERARCHY_PARTICLE + COST_HASH_OCCUPANCY * occupancy + COST_HIERARCHY_UPWARD * upward);
+    }
+
+    if (allPairsCost < bestCost) { resources.autoChoice = BroadphaseType::AllPairs; bestCost = allPairsCost; }
+    if (sweepCost < bestCost) { resources.autoChoice = BroadphaseType::SweepAndPrune; bestCost = sweepCost; }
+
+    // The grid clamps everything outside the bounds into its edge cells
+    if (bounded && uniformRadius)
+    {
+        SpatialGrid& grid = resources.grid;
+        grid.Update(particles);
+
+        double sharedSum = 0.0;
+        for (int cell = 0; cell < grid.GetCellCount(); cell++)
+        {
+            const double cellParticles = static_cast<double>(grid.GetCell(cell).size());
+            sharedSum += cellParticles * cellParticles;
+        }
+        const double occupancy = N > 0.0 ? sharedSum / N : 0.0;
+        const double gridCost = COST_GRID_CELL * grid.GetCellCount()
+            + N * (COST_GRID_PARTICLE + COST_GRID_OCCUPANCY * occupancy);
+
+        if (gridCost < bestCost) { resources.autoChoice = BroadphaseType::UniformGrid; bestCost = gridCost; }
+    }
+    return resources.autoChoice;
+}
+
+void UpdatePhysics(SimulationSystem& sim, float deltaTime, bool useSpacePart)
+{
+    static BroadphaseResources resources(sim);
+    resources.Fit(sim);
+
+    // Whatever grid an earlier step left is out of date now
+    sim.SetCullingGrid(nullptr, ++StepCount());
+
+    PhaseProfiler* profiler = sim.GetProfiler();
+    if (profiler)
+        profiler->BeginStep();
+
+    // Scratch data of the last step (and of ComputeStableTimeStep) isn't needed anymore
+    FrameArena& arena = GetStepArena();
+    arena.Reset();
+
+    // With different sizes every broadphase has to reach the largest contact distance
+    const bool bounded = !sim.IsUnbounded();
+    const bool uniformRadius = !sim.HasChannel(ParticleChannel::Radius);
+    const float pairDistance = 2.0f * (uniformRadius ? sim.GetParticleRadius() : sim.GetMaxParticleRadius());
+    ParticleAttributes& attributes = sim.GetAttributes();
+    const float* radii = uniformRadius ? nullptr : attributes.GetRadius().data();
+    resources.hierarchy.SetRadii(radii, sim.GetParticleRadius());
+
+    // Without space partitioning only all pairs is left
+    BroadphaseType broadphase = useSpacePart ? sim.GetBroadphase() : BroadphaseType::AllPairs;
+    if (broadphase == BroadphaseType::Auto)
+        broadphase = ChooseBroadphase(sim.GetParticles(), pairDistance, bounded, uniformRadius, resources);
+    else if (!uniformRadius && (broadphase == BroadphaseType::UniformGrid || broadphase == BroadphaseType::SpatialHash))
+        broadphase = BroadphaseType::HierarchicalGrid;
+    else if (broadphase == BroadphaseType::UniformGrid && !bounded)
+        broadphase = BroadphaseType::SpatialHash;
+    sim.SetActiveBroadphase(broadphase);
+    ActiveBroadphase() = &resources.Get(broadphase);
+
+    // Hoist every per-step constant out of the particle loop
+    StepContext ctx;
+    ctx.bounds = sim.GetBounds();
+    ctx.deltaTime = deltaTime;
+    ctx.particleRadius = sim.GetParticleRadius();
+    ctx.diameter = 2.0f * ctx.particleRadius;
+    ctx.diameterSq = ctx.diameter * ctx.diameter;
+    ctx.maxRadius = uniformRadius ? ctx.particleRadius : sim.GetMaxParticleRadius();
+    ctx.pairDistance = pairDistance;
+    ctx.mass = sim.GetUniformMass();
+    ctx.broadphase = broadphase;
+    ctx.solver = sim.GetSolver();
+    ctx.deterministic = sim.IsDeterministic();
+    ctx.useBorders = bounded;
+    ctx.incrementalGrid = sim.IsIncrementalGrid();
+    ctx.arena = &arena;
+    ctx.profiler = profiler;
+
+    // Only declared channels are allocated, the others stay null
+    ctx.masses = attributes.Has(ParticleChannel::Mass) ? attributes.GetMass().data() : nullptr;
+    ctx.radii = radii;
+    ctx.temperatures = attributes.Has(ParticleChannel::Temperature) ? attributes.GetTemperature().data() : nullptr;
+    ctx.restSteps = attributes.Has(ParticleChannel::Sleep) ? attributes.GetRestSteps().data() : nullptr;
+    ctx.sleeping = attributes.Has(ParticleChannel::Sleep) ? attributes.GetSleeping().data() : nullptr;
+
+    // Rest detection only works with the grid (sleep flags are per cell). Deterministic
+    // runs ignore it, the grid skips the pairs of sleeping cells and the other
+    // broadphases don't, so they'd no longer solve the same contacts
+    ctx.useSleeping = broadphase == BroadphaseType::UniformGrid && ctx.sleeping != nullptr && !ctx.deterministic;
+    ctx.sleepSpeedSq = sim.GetSleepSpeed() * sim.GetSleepSpeed();
+    ctx.sleepSteps = sim.GetSleepSteps();
+
+    // Threshold relative to the smallest particle, the first one to tunnel
+    const float ccdDistance = sim.GetContinuousCollisionThreshold() * sim.GetMinParticleRadius();
+    ctx.useCCD = sim.IsContinuousCollisionEnabled();
+    ctx.ccdSpeedSq = (ccdDistance / deltaTime) * (ccdDistance / deltaTime);
+
+    const StepKernelFunction kernel = SelectStepKernel(sim.GetIntegrator(),
+        ctx.masses == nullptr, ctx.radii == nullptr, ctx.temperatures != nullptr);
+    LapPhase(ctx, StepPhase::Setup);
+    kernel(sim, resources, ctx);
+    sim.SetGridMovedFraction(resources.grid.GetMovedFraction());
+}
+
+float ComputeStableTimeStep(const SimulationSystem& sim, float maxDisplacement)
+{
+    const std::vector<Particle>& particles = sim.GetParticles();
+    const ParticleAttributes& attributes = sim.GetAttributes();
+    const unsigned char* sleeping = attributes.Has(ParticleChannel::Sleep) ? attributes.GetSleeping().data() : nullptr;
+    const int N = static_cast<int>(particles.size());
+
+    // Per thread partial maxima, combined after the parallel loop
+    ThreadPool& pool = ThreadPool::Get();
+    const int threadCount = pool.GetThreadCount();
+    float* maxSpeedSq = GetStepArena().Allocate<float>(threadCount);
+    float* maxAccelerationSq = GetStepArena().Allocate<float>(threadCount);
+    std::fill(maxSpeedSq, maxSpeedSq + threadCount, 0.0f);
+    std::fill(maxAccelerationSq, maxAccelerationSq + threadCount, 0.0f);
+
+    pool.ParallelFor(0, N, [&](int begin, int end, int thread)
+    {
+        float speedSq = 0.0f;
+        float accelerationSq = 0.0f;
+        for (int i = begin; i < end; i++)
+        {
+            const Particle& particle = particles[i];
+            if (sleeping && sleeping[i]) continue;
+
+            // Same forces as UpdatePhysics
+            const float invMass = 1.0f / sim.GetParticleMass(i);
+            const float ax = G.x - particle.velocity.x * AIR_RESISTANCE * invMass;
+            const float ay = G.y - particle.velocity.y * AIR_RESISTANCE * invMass;
+            speedSq = std::max(speedSq, particle.velocity.length_sq());
+            accelerationSq = std::max(accelerationSq, ax * ax + ay * ay);
+        }
+        maxSpeedSq[thread] = speedSq;
+        maxAccelerationSq[thread] = accelerationSq;
+    });
+
+    float speedSq = 0.0f;
+    float accelerationSq = 0.0f;
+    for (int thread = 0; thread < threadCount; thread++)
+    {
+        speedSq = std::max(speedSq, maxSpeedSq[thread]);
+        accelerationSq = std::max(accelerationSq, maxAccelerationSq[thread]);
+    }
+
+    // Solve v * dt + 0.5 * a * dt^2 = distance for dt
+    const float distance = maxDisplacement * sim.GetMinParticleRadius();
+    const float speed = std::sqrt(speedSq);
+    const float acceleration = std::sqrt(accelerationSq);
+    if (acceleration > 1e-6f)
+        return (-speed + std::sqrt(speed * speed + 2.0f * acceleration * distance)) / acceleration;
+    if (speed > 1e-6f)
+        return distance / speed;
+    return std::numeric_limits<float>::max();
+}
+
+int UpdatePhysicsAdaptive(SimulationSystem& sim, float frameTime, float maxDisplacement,
+    int maxSubSteps, bool useSpacePart)
+{
+    float remaining = frameTime;
+    int steps = 0;
+
+    // Ignore the rounding leftover of the even split
+    while (remaining > frameTime * 1e-4f && steps < maxSubSteps)
+    {
+        float deltaTime = remaining;
+        if (steps < maxSubSteps - 1)
+        {
+            // Split what is left of the frame evenly instead of leaving a tiny last step
+            const float stableStep = ComputeStableTimeStep(sim, maxDisplacement);
+            const float stepsLeft = std::ceil(remaining / stableStep);
+            if (stepsLeft > 1.0f)
+                deltaTime = remaining / stepsLeft;
+        }
 
-        // Solve collision pairs
-        for (const auto& pair : collisionPairs) 
-            SolveCollisionParticle(particles[pair.first], particles[pair.second], sim.GetBounds(), sim.GetParticleRadius());
-        
+        UpdatePhysics(sim, deltaTime, useSpacePart);
+        remaining -= deltaTime;
+        steps++;
     }
-    sim.UpdateStreams(deltaTime);
+    return steps;
 }
\ No newline at end of file
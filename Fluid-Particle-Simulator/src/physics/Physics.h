@@ -2,7 +2,31 @@
 
 #include "SimulationSystem.h"
 #include "SolveCollision.h"
+#include "../core/FrameArena.h"
 
 
-// Update particles inside simulation system particle vector in fixed deltaTime
-void UpdatePhysics(SimulationSystem& sim, float deltaTime, bool useSpacePart);
\ No newline at end of file
+// Update particles inside simulation system particle vector in fixed deltaTime.
+// With useSpacePart the broadphase set on the simulation is used (see BroadphaseType),
+// without it every pair is tested by the all pairs kernel
+void UpdatePhysics(SimulationSystem& sim, float deltaTime, bool useSpacePart);
+
+// Largest deltaTime (CFL condition) for which no particle moves more than
+// maxDisplacement * particleRadius, computed from the maximum speed and acceleration
+// with a parallel reduction over the particles
+float ComputeStableTimeStep(const SimulationSystem& sim, float maxDisplacement);
+
+// Advance the simulation by frameTime with as many adaptive substeps as the
+// CFL condition requires (at most maxSubSteps). Returns the number of substeps taken
+int UpdatePhysicsAdaptive(SimulationSystem& sim, float frameTime, float maxDisplacement,
+    int maxSubSteps, bool useSpacePart);
+
+// Number of UpdatePhysics calls so far, whatever the simulation. A grid published
+// through SimulationSystem::SetCullingGrid is current while this hasn't moved
+uint64_t GetPhysicsStepCount();
+
+// Broadphase::GetName() of the broadphase the last UpdatePhysics ran, "none" before the first
+const char* GetActiveBroadphaseName();
+
+// Scratch memory of the step (candidate lists, canonical pairs, solver buffers...),
+// reset at the start of every UpdatePhysics
+FrameArena& GetStepArena();
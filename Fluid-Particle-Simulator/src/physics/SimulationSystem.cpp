@@ -1,13 +1,22 @@
 #include "SimulationSystem.h"
+#include "Physics.h"
+#include "../core/Random.h"
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Random streams of the emitters start here, the particle streams use 0, 1, 2...
+const uint64_t EMITTER_RANDOM_STREAM = 1ull << 32;
 
 SimulationSystem::SimulationSystem(const Vec2& bottomLeft, const Vec2& topRight, float particleRadius, unsigned int windowWidth)
     : m_Bounds({ bottomLeft, topRight }), m_ParticleRadius(particleRadius),
-    m_Zoom(1.0f), m_WindowWidth(windowWidth)
+    m_Zoom(1.0f), m_WindowWidth(windowWidth),
+    m_MinParticleRadius(particleRadius), m_MaxParticleRadius(particleRadius)
 {
     m_SimHeight = std::abs(topRight.y - bottomLeft.y);
     m_SimWidth = std::abs(topRight.x - bottomLeft.x);
+    m_Attributes.SetDefaultRadius(particleRadius);
 }
 
 SimulationSystem::~SimulationSystem()
@@ -19,16 +28,84 @@ SimulationSystem::~SimulationSystem()
     }
 }
 
-void SimulationSystem::AddParticle(const Vec2& position, const Vec2& velocity, float mass)
+void SimulationSystem::AddParticle(const Vec2& position, const Vec2& velocity, float mass, float radius)
+{
+    const int index = SpawnBatch(1, mass, radius);
+    m_Particles[index].position = position;
+    m_Particles[index].velocity = velocity;
+}
+
+int SimulationSystem::SpawnBatch(int count, float mass, float radius)
+{
+    const int first = static_cast<int>(m_Particles.size());
+    if (count <= 0)
+        return first;
+
+    if (m_Particles.empty() && m_UniformMass) {
+        m_ParticleMass = mass;
+        m_Attributes.SetDefaultMass(mass);
+    }
+    else if (m_UniformMass && mass != m_ParticleMass) {
+        // Masses differ from now on, store them per particle
+        m_UniformMass = false;
+        m_Attributes.Declare(ParticleChannel::Mass);
+    }
+
+    if (radius <= 0.0f)
+        radius = m_ParticleRadius;
+    if (m_UniformRadius && radius != m_ParticleRadius) {
+        // Sizes differ from now on, store them per particle
+        m_UniformRadius = false;
+        m_Attributes.Declare(ParticleChannel::Radius);
+    }
+    m_MinParticleRadius = std::min(m_MinParticleRadius, radius);
+    m_MaxParticleRadius = std::max(m_MaxParticleRadius, radius);
+
+    m_Particles.resize(first + count, Particle(Vec2(0.0f, 0.0f), Vec2(0.0f, 0.0f)));
+    m_Attributes.Append(count, mass, radius);
+    m_TopologyVersion++;
+    return first;
+}
+
+void SimulationSystem::RemoveParticle(int index)
+{
+    const int last = static_cast<int>(m_Particles.size()) - 1;
+    if (index != last) {
+        m_Particles[index] = m_Particles[last];
+        m_Attributes.Move(last, index);
+    }
+    m_Particles.pop_back();
+    m_Attributes.Truncate(last);
+    m_TopologyVersion++;
+    m_RemovalVersion++;
+}
+
+void SimulationSystem::SetCullingGrid(const SpatialGrid* grid, uint64_t step)
+{
+    m_CullingGrid = grid;
+    m_CullingGridParticles = static_cast<int>(m_Particles.size());
+    m_CullingGridRemovals = m_RemovalVersion;
+    m_CullingGridStep = step;
+}
+
+const SpatialGrid* SimulationSystem::GetCullingGrid() const
 {
-    Particle newParticle(position, velocity, mass);
-    m_Particles.push_back(newParticle);
+    if (m_CullingGridStep != GetPhysicsStepCount() || m_CullingGridRemovals != m_RemovalVersion)
+        return nullptr;
+    return m_CullingGrid;
+}
+
+void SimulationSystem::ReserveParticles(size_t count)
+{
+    m_Particles.reserve(count);
+    m_Attributes.Reserve(count);
 }
 
 void SimulationSystem::AddParticleGrid(int rows, int cols, Vec2 spacing, bool withInitialVelocity, float mass)
 {
     // Reserve memory at the start
     m_Particles.reserve(m_Particles.size() + rows * cols);
+    m_Attributes.Reserve(m_Particles.size() + rows * cols);
 
     // Calculate the starting position (top-left corner of the simulation area)
     float startX = m_Bounds.bottomLeft.x + m_ParticleRadius;
@@ -100,7 +177,7 @@ glm::mat4 SimulationSystem::GetViewMatrix() const
 }
 
 void SimulationSystem::AddParticleStream(int totalParticles, float spawnRate, const Vec2& velocity,
-    float mass, const Vec2& initialOffset)
+    float mass, const Vec2& initialOffset, float radius, float spread)
 {
     ParticleStream newStream;
     newStream.isActive = true;
@@ -115,25 +192,239 @@ void SimulationSystem::AddParticleStream(int totalParticles, float spawnRate, co
     newStream.timer = 0.0f;
     newStream.spawned = 0;
     newStream.mass = mass;
+    newStream.radius = radius;
+    newStream.spread = spread;
 
     m_Streams.push_back(newStream);
+    ReservePending();
+}
+
+void SimulationSystem::ReservePending()
+{
+    // Room for everything still to spawn, so spawning during the steps doesn't
+    // reallocate the particles
+    size_t pending = 0;
+    for (const ParticleStream& stream : m_Streams)
+        pending += static_cast<size_t>(std::max(0, stream.total - stream.spawned));
+    for (const Emitter& emitter : m_Emitters)
+        if (emitter.active && emitter.total > emitter.emitted)
+            pending += static_cast<size_t>(emitter.total - emitter.emitted);
+    ReserveParticles(m_Particles.size() + pending);
 }
 void SimulationSystem::UpdateStreams(float deltaTime)
 {
-    // Use iterator to allow removing completed streams if needed
-    for (auto& stream : m_Streams) {
+    for (size_t streamIndex = 0; streamIndex < m_Streams.size(); streamIndex++) {
+        ParticleStream& stream = m_Streams[streamIndex];
         if (!stream.isActive || stream.spawned >= stream.total) continue;
 
         stream.timer += deltaTime;
 
-        while (stream.timer >= stream.spawnInterval && stream.spawned < stream.total) {
-            AddParticle(stream.startPos, stream.velocity, stream.mass);
-            stream.spawned++;
+        // Particles due this step, appended in one batch
+        int due = 0;
+        while (stream.timer >= stream.spawnInterval && stream.spawned + due < stream.total) {
             stream.timer -= stream.spawnInterval;
+            due++;
         }
+        if (due == 0) continue;
+
+        const int first = SpawnBatch(due, stream.mass, stream.radius);
+        for (int k = 0; k < due; k++) {
+            Vec2 velocity = stream.velocity;
+            if (stream.spread > 0.0f) {
+                // Keyed by the stream and the particle's rank in it
+                CounterRandom random(m_Seed, streamIndex, static_cast<uint64_t>(stream.spawned + k));
+                const float angle = random.NextFloat(-0.5f, 0.5f) * stream.spread;
+                const float c = std::cos(angle);
+                const float s = std::sin(angle);
+                velocity = Vec2(c * velocity.x - s * velocity.y, s * velocity.x + c * velocity.y);
+            }
+
+            m_Particles[first + k].position = stream.startPos;
+            m_Particles[first + k].velocity = velocity;
+        }
+        stream.spawned += due;
     }
 }
 
+int SimulationSystem::AddEmitter(const Emitter& emitter)
+{
+    m_Emitters.push_back(emitter);
+    ReservePending();
+    return static_cast<int>(m_Emitters.size()) - 1;
+}
+
+void SimulationSystem::UpdateEmitters(float deltaTime)
+{
+    for (size_t emitterIndex = 0; emitterIndex < m_Emitters.size(); emitterIndex++) {
+        Emitter& emitter = m_Emitters[emitterIndex];
+        if (!emitter.active) continue;
+
+        // Whole intervals elapsed, the fraction left over carries to the next step
+        long long due;
+        if (emitter.shape == EmitterShape::Burst) {
+            due = std::max(0LL, emitter.total - emitter.emitted);
+            emitter.timer = 0.0f;
+        }
+        else if (emitter.rate <= 0.0f) {
+            // Paused, the rate can be raised later through GetEmitter
+            continue;
+        }
+        else {
+            emitter.timer += deltaTime;
+            due = static_cast<long long>(emitter.timer * emitter.rate);
+            emitter.timer -= static_cast<float>(due) / emitter.rate;
+            if (emitter.total >= 0)
+                due = std::min(due, emitter.total - emitter.emitted);
+        }
+
+        if (due > 0) {
+            const int first = SpawnBatch(static_cast<int>(due), emitter.mass, emitter.radius);
+            Particle* slots = m_Particles.data() + first;
+            const float speed = emitter.velocity.length();
+
+            for (int k = 0; k < static_cast<int>(due); k++) {
+                // Keyed by the emitter and the particle's rank in it, away from the streams
+                CounterRandom random(m_Seed, EMITTER_RANDOM_STREAM + emitterIndex,
+                    static_cast<uint64_t>(emitter.emitted + k));
+
+                Vec2 position = emitter.position;
+                Vec2 velocity = emitter.velocity;
+                switch (emitter.shape) {
+                case EmitterShape::Line:
+                    position += (emitter.end - emitter.position) * random.NextFloat();
+                    break;
+                case EmitterShape::Disc:
+                case EmitterShape::Burst: {
+                    // sqrt keeps the density uniform over the disc
+                    const float distance = emitter.size * std::sqrt(random.NextFloat());
+                    const float angle = random.NextFloat() * 6.28318531f;
+                    const Vec2 direction(std::cos(angle), std::sin(angle));
+                    position += direction * distance;
+                    if (emitter.shape == EmitterShape::Burst)
+                        velocity = direction * speed;
+                    break;
+                }
+                default:
+                    break;
+                }
+
+                if (emitter.spread > 0.0f) {
+                    const float angle = random.NextFloat(-0.5f, 0.5f) * emitter.spread;
+                    const float c = std::cos(angle);
+                    const float s = std::sin(angle);
+                    velocity = Vec2(c * velocity.x - s * velocity.y, s * velocity.x + c * velocity.y);
+                }
+
+                // Particle k left the emitter (due - 1 - k) intervals before the last one,
+                // move it along by its age so a fast jet doesn't spawn as one clump
+                if (emitter.shape != EmitterShape::Burst)
+                    position += velocity * (emitter.timer + (due - 1 - k) / emitter.rate);
+
+                slots[k].position = position;
+                slots[k].velocity = velocity;
+            }
+            emitter.emitted += due;
+        }
+
+        if (emitter.shape == EmitterShape::Burst || (emitter.total >= 0 && emitter.emitted >= emitter.total))
+            emitter.active = false;
+    }
+
+    ApplyKillZones();
+}
+
+void SimulationSystem::ApplyKillZones()
+{
+    if (m_KillZones.empty()) return;
+
+    // Swap-remove in one pass: a killed slot takes the last particle, which is tested next
+    int count = static_cast<int>(m_Particles.size());
+    int i = 0;
+    while (i < count) {
+        const Vec2& position = m_Particles[i].position;
+        bool killed = false;
+        for (const KillZone& zone : m_KillZones) {
+            if (position.x >= zone.bottomLeft.x && position.x <= zone.topRight.x &&
+                position.y >= zone.bottomLeft.y && position.y <= zone.topRight.y) {
+                killed = true;
+                break;
+            }
+        }
+
+        if (!killed) {
+            i++;
+            continue;
+        }
+
+        count--;
+        if (i != count) {
+            m_Particles[i] = m_Particles[count];
+            m_Attributes.Move(count, i);
+        }
+    }
+
+    if (count < static_cast<int>(m_Particles.size())) {
+        m_Particles.erase(m_Particles.begin() + count, m_Particles.end());
+        m_Attributes.Truncate(count);
+        m_TopologyVersion++;
+        m_RemovalVersion++;
+    }
+}
+
+void SimulationSystem::SetSleeping(bool enabled, float sleepSpeed, int sleepSteps)
+{
+    m_SleepingEnabled = enabled;
+    m_SleepSpeed = sleepSpeed;
+    m_SleepSteps = sleepSteps;
+
+    // Dropping the channel also wakes everything up, no particle stays frozen
+    if (enabled)
+        m_Attributes.Declare(ParticleChannel::Sleep);
+    else
+        m_Attributes.Release(ParticleChannel::Sleep);
+}
+
+void SimulationSystem::SetTemperatureEnabled(bool enabled)
+{
+    m_TemperatureEnabled = enabled;
+
+    if (enabled)
+        m_Attributes.Declare(ParticleChannel::Temperature);
+    else
+        m_Attributes.Release(ParticleChannel::Temperature);
+}
+
+uint64_t SimulationSystem::ComputeStateChecksum() const
+{
+    // Bit patterns rather than values, a replay has to match them exactly
+    uint64_t hash = Mix64(m_Particles.size());
+    auto add = [&hash](uint64_t word) { hash = (hash ^ Mix64(word)) * 0x9E3779B97F4A7C15ull; };
+
+    for (const Particle& particle : m_Particles) {
+        uint64_t position, velocity;
+        std::memcpy(&position, &particle.position, sizeof(position));
+        std::memcpy(&velocity, &particle.velocity, sizeof(velocity));
+        add(position);
+        add(velocity);
+    }
+
+    auto addColumn = [&add](const std::vector<float>& column) {
+        for (const float value : column) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            add(bits);
+        }
+    };
+    addColumn(m_Attributes.GetMass());
+    addColumn(m_Attributes.GetRadius());
+    addColumn(m_Attributes.GetTemperature());
+    for (const int steps : m_Attributes.GetRestSteps())
+        add(static_cast<uint32_t>(steps));
+    for (const unsigned char sleeping : m_Attributes.GetSleeping())
+        add(sleeping);
+    return hash;
+}
+
 void SimulationSystem::InitSpatialGrid()
 {
     if (m_SpatialGrid) {
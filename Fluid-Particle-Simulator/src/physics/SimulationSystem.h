@@ -1,20 +1,52 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
 #include "Particle.h"
+#include "ParticleAttributes.h"
+#include "Emitter.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include "SpatialGrid.h" 
 
+class PhaseProfiler;
+
 struct Bounds {
     Vec2 bottomLeft;
     Vec2 topRight;
 };
 
+// Integration scheme used by UpdatePhysics
+enum class IntegratorType {
+    SemiImplicitEuler,
+    VelocityVerlet
+};
+
+// How UpdatePhysics resolves the contact pairs. Gauss-Seidel applies every pair in
+// place, in the order the broadphase found them. Jacobi computes every pair from the
+// same state and applies the sum per particle afterwards, in parallel and with the
+// same result for any thread count
+enum class SolverType {
+    GaussSeidel,
+    Jacobi
+};
+
+// Broadphase used by UpdatePhysics when space partitioning is on. Auto compares the
+// estimated cost of each one from the particle count and the measured densities
+enum class BroadphaseType {
+    Auto,
+    AllPairs,
+    UniformGrid,
+    SweepAndPrune,
+    SpatialHash,
+    HierarchicalGrid
+};
+
 // Object to control the simulation
 class SimulationSystem
 {
 private:
     std::vector<Particle> m_Particles;     
+    ParticleAttributes m_Attributes;
     Bounds m_Bounds;
     float m_ParticleRadius;
     float m_Zoom;
@@ -22,8 +54,35 @@ private:
     float m_SimWidth;
     unsigned int m_WindowWidth;
     bool m_UseSpatialGrid = true;
+    bool m_Unbounded = false;
     SpatialGrid* m_SpatialGrid = nullptr;
 
+    // Rest detection
+    bool m_SleepingEnabled = false;
+    float m_SleepSpeed = 2.0f;
+    int m_SleepSteps = 60;
+
+    // Continuous collision detection
+    bool m_CCDEnabled = false;
+    float m_CCDThreshold = 0.5f;
+
+    // Step kernel selection
+    IntegratorType m_Integrator = IntegratorType::SemiImplicitEuler;
+    SolverType m_Solver = SolverType::GaussSeidel;
+    bool m_Deterministic = false;
+    uint64_t m_Seed = 0;
+    BroadphaseType m_Broadphase = BroadphaseType::Auto;
+    BroadphaseType m_ActiveBroadphase = BroadphaseType::UniformGrid;
+    bool m_IncrementalGrid = false;
+    float m_GridMovedFraction = 1.0f;
+    PhaseProfiler* m_Profiler = nullptr;
+    bool m_TemperatureEnabled = false;
+    bool m_UniformMass = true;
+    float m_ParticleMass = 1.0f;
+    bool m_UniformRadius = true;
+    float m_MinParticleRadius;
+    float m_MaxParticleRadius;
+
     struct ParticleStream {
         bool isActive = false;
         Vec2 startPos;
@@ -33,9 +92,31 @@ private:
         float spawnInterval = 0.0f;
         float timer = 0.0f;
         float mass = 1.0f;  
+        float radius = 0.0f;
+        float spread = 0.0f;
     };
 
     std::vector<ParticleStream> m_Streams;
+    std::vector<Emitter> m_Emitters;
+    std::vector<KillZone> m_KillZones;
+
+    // Bumped whenever particles are added or removed
+    unsigned int m_TopologyVersion = 0;
+
+    // Bumped when particles are removed only, appending keeps the indices of the others
+    unsigned int m_RemovalVersion = 0;
+
+    // Uniform grid filled by the last step, see GetCullingGrid
+    const SpatialGrid* m_CullingGrid = nullptr;
+    int m_CullingGridParticles = 0;
+    unsigned int m_CullingGridRemovals = 0;
+    uint64_t m_CullingGridStep = 0;
+
+    // Reserve room for what the streams and emitters still have to spawn
+    void ReservePending();
+
+    // Swap-remove every particle inside a kill zone
+    void ApplyKillZones();
 
 public:
     // bottomLeft is the bottom-left corner of the simulation rectangle and
@@ -46,8 +127,24 @@ public:
     SimulationSystem(const Vec2& bottomLeft, const Vec2& topRight, float particleRadius, unsigned int windowWidth);
     ~SimulationSystem();
 
-    // Add new particle to particle vector, default mass is 1.0f. 
-    void AddParticle(const Vec2& position, const Vec2& velocity, float mass = 1.0f);
+    // Add new particle to particle vector, default mass is 1.0f. A radius of 0 (default)
+    // means the radius given to the constructor
+    void AddParticle(const Vec2& position, const Vec2& velocity, float mass = 1.0f, float radius = 0.0f);
+
+    // Append count particles at once and return the index of the first one. They get the
+    // mass and radius (0 = default) and a zero position and velocity for the caller to write
+    int SpawnBatch(int count, float mass = 1.0f, float radius = 0.0f);
+
+    // Remove a particle by moving the last one (all channels) into its slot, storage
+    // stays dense. The last particle changes index, see GetTopologyVersion
+    void RemoveParticle(int index);
+
+    // Room for count particles in total, spawning up to there never reallocates
+    void ReserveParticles(size_t count);
+
+    // Changes every time particles are added or removed, anything keeping per-particle
+    // state between steps has to rebuild it when this moved
+    unsigned int GetTopologyVersion() const { return m_TopologyVersion; }
 
     // Function used to create a grid of (rows * cols) particles, the particles will be 
     // automatically generated in the top-left corner of the simulation. By default the 
@@ -57,8 +154,10 @@ public:
     // This is to avoid a bug that doesn't separate the particles
     void AddParticleGrid(int rows, int cols, Vec2 spacing, bool withInitialVelocity, float mass = 1.0f);
 
+    // spread is the angle (radians) the velocity of every spawned particle is randomly
+    // turned by, at most spread / 2 either way. The numbers come from the seed
     void AddParticleStream(int totalParticles, float spawnRate, const Vec2& velocity,
-        float mass, const Vec2& initialOffset);
+        float mass, const Vec2& initialOffset, float radius = 0.0f, float spread = 0.0f);
 
     // Replace StartParticleStream with AddParticleStream
     // Update the UpdateStream method
@@ -70,10 +169,47 @@ public:
     // Method to get active stream count
     size_t GetActiveStreamCount() const { return m_Streams.size(); }
 
+    // Emitters and kill zones, see Emitter.h. Emitters with a total reserve it up front,
+    // unlimited ones should be given a pool with ReserveParticles
+    int AddEmitter(const Emitter& emitter);
+    Emitter& GetEmitter(int index) { return m_Emitters[index]; }
+    void ClearEmitters() { m_Emitters.clear(); }
+    void AddKillZone(const Vec2& bottomLeft, const Vec2& topRight) { m_KillZones.push_back({ bottomLeft, topRight }); }
+    void ClearKillZones() { m_KillZones.clear(); }
+
+    // Spawn what the emitters owe for deltaTime, then remove the particles in kill zones
+    void UpdateEmitters(float deltaTime);
+
     const std::vector<Particle>& GetParticles() const { return m_Particles; } // THIS ONE IS JUST OT COPY 
     std::vector<Particle>& GetParticles() { return m_Particles; } // THIS ONE IS TO MODIFY THE VECTORIT
 
+    // Optional per-particle channels, same indexing as GetParticles(). Only declared
+    // channels are allocated, adding particles through GetParticles() bypasses them
+    const ParticleAttributes& GetAttributes() const { return m_Attributes; }
+    ParticleAttributes& GetAttributes() { return m_Attributes; }
+    void DeclareChannel(ParticleChannel channel) { m_Attributes.Declare(channel); }
+    void ReleaseChannel(ParticleChannel channel) { m_Attributes.Release(channel); }
+    bool HasChannel(ParticleChannel channel) const { return m_Attributes.Has(channel); }
+
+    // Mass of one particle, from the mass channel if masses differ
+    float GetParticleMass(int index) const
+    {
+        return m_Attributes.Has(ParticleChannel::Mass) ? m_Attributes.GetMass()[index] : m_ParticleMass;
+    }
+
+    // Radius of one particle, from the radius channel if sizes differ
+    float GetParticleRadius(int index) const
+    {
+        return m_Attributes.Has(ParticleChannel::Radius) ? m_Attributes.GetRadius()[index] : m_ParticleRadius;
+    }
+
     const Bounds& GetBounds() const { return m_Bounds; }
+
+    // Unbounded simulations have no border collisions, the bounds only frame the
+    // camera and the spawn positions. The uniform grid needs bounds, UpdatePhysics
+    // replaces it with the spatial hash
+    void SetUnbounded(bool unbounded) { m_Unbounded = unbounded; }
+    bool IsUnbounded() const { return m_Unbounded; }
     
     // Return projection matrix for rendering the simulation
     glm::mat4 GetProjMatrix() const;
@@ -81,9 +217,17 @@ public:
     // Return a view matrix for the simulation
     glm::mat4 GetViewMatrix() const;
 
-    // Return particle radius
+    // Return particle radius (the default one when sizes differ)
     float GetParticleRadius() const { return m_ParticleRadius; }
 
+    // True while every particle added so far has the default radius, otherwise the
+    // radius channel is declared and the step kernel reads it per pair
+    bool HasUniformRadius() const { return m_UniformRadius; }
+
+    // Smallest and largest radius of the particles added so far
+    float GetMinParticleRadius() const { return m_MinParticleRadius; }
+    float GetMaxParticleRadius() const { return m_MaxParticleRadius; }
+
     // Return simulation zoom
     float GetZoom() const { return m_Zoom; }
 
@@ -105,6 +249,88 @@ public:
     // Initialize the spatial grid
     void InitSpatialGrid();
 
+    // Rest detection (space partitioning only). A particle slower than sleepSpeed for
+    // sleepSteps consecutive substeps is at rest, a grid cell falls asleep when all of its
+    // particles and the ones in the 8 neighbour cells are at rest. Sleeping particles are
+    // skipped by integration and narrowphase until something moves next to them
+    void SetSleeping(bool enabled, float sleepSpeed = 2.0f, int sleepSteps = 60);
+    bool IsSleepingEnabled() const { return m_SleepingEnabled; }
+    float GetSleepSpeed() const { return m_SleepSpeed; }
+    int GetSleepSteps() const { return m_SleepSteps; }
+
+    // Continuous collision detection. Particles moving more than threshold * radius in
+    // a single step are swept against their neighbours and the borders and sub-stepped
+    // at every time of impact, so global substeps can stay low without tunnelling
+    void SetContinuousCollision(bool enabled, float threshold = 0.5f) { m_CCDEnabled = enabled; m_CCDThreshold = threshold; }
+    bool IsContinuousCollisionEnabled() const { return m_CCDEnabled; }
+    float GetContinuousCollisionThreshold() const { return m_CCDThreshold; }
+
+    // Integration scheme, UpdatePhysics dispatches to a kernel specialised for it
+    void SetIntegrator(IntegratorType integrator) { m_Integrator = integrator; }
+    IntegratorType GetIntegrator() const { return m_Integrator; }
+
+    // Contact solver, see SolverType
+    void SetSolver(SolverType solver) { m_Solver = solver; }
+    SolverType GetSolver() const { return m_Solver; }
+
+    // Deterministic mode: the contact pairs are reduced to the ones touching and sorted
+    // by particle index before solving, so the result no longer depends on which
+    // broadphase found them or in which order. Together with the thread count
+    // independent solvers and the counter-based random numbers a run can be replayed
+    // bit for bit on the same build. Sleeping is ignored meanwhile, the grid would leave
+    // out the pairs of sleeping cells
+    void SetDeterministic(bool deterministic) { m_Deterministic = deterministic; }
+    bool IsDeterministic() const { return m_Deterministic; }
+
+    // Seed of every random number the simulation draws (stream spread)
+    void SetSeed(uint64_t seed) { m_Seed = seed; }
+    uint64_t GetSeed() const { return m_Seed; }
+
+    // 64 bit hash of the bit patterns of the whole state (particles and declared
+    // channels), cheap enough to compare two runs after every step
+    uint64_t ComputeStateChecksum() const;
+
+    // Broadphase selection, the active one is what UpdatePhysics actually ran last
+    // (never Auto). Rest detection only runs while the grid is active
+    void SetBroadphase(BroadphaseType broadphase) { m_Broadphase = broadphase; }
+    BroadphaseType GetBroadphase() const { return m_Broadphase; }
+    void SetActiveBroadphase(BroadphaseType broadphase) { m_ActiveBroadphase = broadphase; }
+    BroadphaseType GetActiveBroadphase() const { return m_ActiveBroadphase; }
+
+    // Incremental grid: the uniform grid remembers the cell of every particle and only
+    // moves the ones that changed cell between substeps instead of rebuilding. The moved
+    // fraction is what the last grid update saw, 1 for full rebuilds
+    void SetIncrementalGrid(bool incremental) { m_IncrementalGrid = incremental; }
+    bool IsIncrementalGrid() const { return m_IncrementalGrid; }
+    void SetGridMovedFraction(float fraction) { m_GridMovedFraction = fraction; }
+    float GetGridMovedFraction() const { return m_GridMovedFraction; }
+
+    // UpdatePhysics publishes the uniform grid it filled (null when the step didn't use
+    // it) so the renderer can find the particles on screen through its cells. The grid
+    // belongs to UpdatePhysics and is refilled by any other simulation it steps, so it's
+    // only handed out while no other step ran and no particle was removed since. It holds
+    // the first GetCullingGridParticles() particles, as of before the collisions moved
+    // them, the ones after were spawned later
+    void SetCullingGrid(const SpatialGrid* grid, uint64_t step);
+    const SpatialGrid* GetCullingGrid() const;
+    int GetCullingGridParticles() const { return m_CullingGridParticles; }
+
+    // Time every phase of UpdatePhysics into profiler, null (default) to stop. The
+    // profiler isn't owned
+    void SetProfiler(PhaseProfiler* profiler) { m_Profiler = profiler; }
+    PhaseProfiler* GetProfiler() const { return m_Profiler; }
+
+    // Toggle the temperature model (speed and collision heating), this declares or
+    // releases the temperature channel
+    void SetTemperatureEnabled(bool enabled);
+    bool IsTemperatureEnabled() const { return m_TemperatureEnabled; }
+
+    // True while every particle added so far has the same mass, in that case the
+    // step kernel skips all per-particle mass divisions and no mass channel is stored.
+    // The first particle with a different mass declares the mass channel
+    bool HasUniformMass() const { return m_UniformMass; }
+    float GetUniformMass() const { return m_ParticleMass; }
+
     // Get the spatial grid
     SpatialGrid* GetSpatialGrid() { return m_SpatialGrid; }
 };
\ No newline at end of file
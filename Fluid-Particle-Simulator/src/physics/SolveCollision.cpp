@@ -1,9 +1,6 @@
 #include "SolveCollision.h"
 #include <cmath>
 
-// Value between 0 (inelastic) and 1 (perfectly elastic)
-const float BOUNCINESS = 1.0f;
-
 void SolveCollisionBorder(Particle& particleA,
     const Bounds bounds,
     float particleRadius)
@@ -49,8 +46,34 @@ void SolveCollisionBorder(Particle& particleA,
     }
 }
 
-void SolveCollisionParticle(Particle& particleA, Particle& particleB,
-    const Bounds bounds, float particleRadius)
+float SolveImpactParticle(Particle& particleA, Particle& particleB, float massA, float massB)
+{
+    const float dx = particleA.position.x - particleB.position.x;
+    const float dy = particleA.position.y - particleB.position.y;
+    const float distance = sqrt(dx * dx + dy * dy);
+    if (distance < 1e-5f) return 0.0f;
+
+    const float nx = dx / distance;
+    const float ny = dy / distance;
+
+    const float vx = particleA.velocity.x - particleB.velocity.x;
+    const float vy = particleA.velocity.y - particleB.velocity.y;
+    const float velocityAlongNormal = vx * nx + vy * ny;
+    if (velocityAlongNormal >= 0)
+        return 0.0f;
+
+    const float impulseScalar = -(1.0f + BOUNCINESS) * velocityAlongNormal;
+    const float impulse = impulseScalar / (1.0f / massA + 1.0f / massB);
+
+    particleA.velocity.x += impulse * nx / massA;
+    particleA.velocity.y += impulse * ny / massA;
+    particleB.velocity.x -= impulse * nx / massB;
+    particleB.velocity.y -= impulse * ny / massB;
+    return impulse;
+}
+
+float SolveCollisionParticle(Particle& particleA, Particle& particleB,
+    const Bounds bounds, float particleRadius, float massA, float massB)
 {
     // Manual position delta and distance calculation
     const float dx = particleA.position.x - particleB.position.x;
@@ -61,7 +84,7 @@ void SolveCollisionParticle(Particle& particleA, Particle& particleB,
     if (distanceSquared < minDistanceSquared)
     {
         const float distance = sqrt(distanceSquared);
-        if (distance < 1e-5f) return;
+        if (distance < 1e-5f) return 0.0f;
 
         // Manually normalize collision normal (avoid glm::vec2 division)
         const float invDistance = 1.0f / distance;
@@ -70,9 +93,9 @@ void SolveCollisionParticle(Particle& particleA, Particle& particleB,
 
         // Position correction
         const float overlap = 2.0f * particleRadius - distance;
-        const float totalMass = particleA.mass + particleB.mass;
-        const float ratioA = particleB.mass / totalMass;
-        const float ratioB = particleA.mass / totalMass;
+        const float totalMass = massA + massB;
+        const float ratioA = massB / totalMass;
+        const float ratioB = massA / totalMass;
 
         particleA.position.x += nx * overlap * ratioA;
         particleA.position.y += ny * overlap * ratioA;
@@ -88,17 +111,14 @@ void SolveCollisionParticle(Particle& particleA, Particle& particleB,
         {
             const float restitution = BOUNCINESS;
             const float impulseScalar = -(1.0f + restitution) * velocityAlongNormal;
-            const float impulse = impulseScalar / (1.0f / particleA.mass + 1.0f / particleB.mass);
-
-            particleA.velocity.x += impulse * nx / particleA.mass;
-            particleA.velocity.y += impulse * ny / particleA.mass;
-            particleB.velocity.x -= impulse * nx / particleB.mass;
-            particleB.velocity.y -= impulse * ny / particleB.mass;
+            const float impulse = impulseScalar / (1.0f / massA + 1.0f / massB);
 
-            // Temperature update (optional)
-            const float collisionIntensity = sqrt(impulse * impulse) * 0.01f;
-            particleA.temperature = std::min(100.0f, particleA.temperature + collisionIntensity);
-            particleB.temperature = std::min(100.0f, particleB.temperature + collisionIntensity);
+            particleA.velocity.x += impulse * nx / massA;
+            particleA.velocity.y += impulse * ny / massA;
+            particleB.velocity.x -= impulse * nx / massB;
+            particleB.velocity.y -= impulse * ny / massB;
+            return impulse;
         }
     }
+    return 0.0f;
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 #include "SimulationSystem.h"
 
+// Value between 0 (inelastic) and 1 (perfectly elastic)
+const float BOUNCINESS = 1.0f;
+
 // Solve collision between particle (particleA) and simulation 
 void SolveCollisionBorder(Particle& particleA,
     const Bounds bounds,
@@ -8,7 +11,14 @@ void SolveCollisionBorder(Particle& particleA,
 
 // Solve collision between particle A and particle B.
 // At the moment this function doesn't use the GLM vector library because 
-// it was slowing down my code too much 
-void SolveCollisionParticle(Particle& particleA, Particle& particleB,
+// it was slowing down my code too much. Returns the impulse applied (0 if none)
+// so the caller can heat the particles when the temperature channel is declared
+float SolveCollisionParticle(Particle& particleA, Particle& particleB,
     const Bounds bounds,
-    float particleRadius);
\ No newline at end of file
+    float particleRadius,
+    float massA = 1.0f, float massB = 1.0f);
+
+// Resolve only the velocities of two particles that are exactly touching,
+// used by continuous collision detection at the time of impact. Returns the impulse
+float SolveImpactParticle(Particle& particleA, Particle& particleB,
+    float massA = 1.0f, float massB = 1.0f);
\ No newline at end of file
@@ -1,9 +1,22 @@
 #pragma once
 #include <vector>
 #include <utility>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
 #include "Vec2.h"
+#include "Broadphase.h"
+#include "../core/BitScan.h"
 
-class SpatialGrid {
+// A cell about 2 diameters wide holds up to ~8 touching particles, twice that leaves
+// room for the overlap of a compressed pile
+const int GRID_MIN_CELL_CAPACITY = 16;
+
+// UpdateIncremental rebuilds from scratch instead when more than this fraction of the
+// particles changed cell, past it the removals cost more than clearing everything
+const float GRID_INCREMENTAL_MAX_MOVED = 0.05f;
+
+class SpatialGrid : public Broadphase {
 private:
     float m_CellSize;
     Vec2 m_MinBound;
@@ -11,11 +24,25 @@ private:
     int m_GridWidth;
     int m_GridHeight;
     std::vector<std::vector<int>> m_Grid;
+    std::vector<unsigned char> m_CellAsleep;
+
+    // One bit per cell, set when it holds a particle. Each row starts on its own word so
+    // walking the occupied cells of a mostly empty box is a bit scan per 64 cells
+    std::vector<uint64_t> m_Occupancy;
+    int m_RowWords;
     std::vector<std::pair<int, int>> m_CollisionPairs;
     int m_ParticleCount;
 
-    // Neighbor offsets as pairs (dx, dy)
-    static constexpr std::pair<int, int> NEIGHBOR_OFFSETS[3] = { {1, 0}, {1, 1}, {0, 1} };
+    // Cell of every particle as of the last update, for UpdateIncremental. Invalid once
+    // cells were edited from outside through InsertParticleInCell / RemoveParticleFromCell
+    std::vector<int> m_ParticleCells;
+    bool m_CellsCached = false;
+    float m_MovedFraction = 1.0f;
+    bool m_LastUpdateFull = true;
+
+    // Neighbor offsets as pairs (dx, dy), half of the 8 neighbours so every pair of
+    // cells is visited once
+    static constexpr std::pair<int, int> NEIGHBOR_OFFSETS[4] = { {1, 0}, {1, 1}, {0, 1}, {-1, 1} };
 
     // Directly compute 1D cell index from position
     inline int GetCellIndex(const Vec2& position) const
@@ -27,6 +54,60 @@ private:
         return x + y * m_GridWidth;
     }
 
+    inline void SetOccupied(int x, int y)
+    {
+        m_Occupancy[y * m_RowWords + (x >> 6)] |= 1ull << (x & 63);
+    }
+
+    // Every edit of a cell goes through these so the bitmap always matches the cells
+    inline void PushToCell(int particleIndex, int cellIndex)
+    {
+        m_Grid[cellIndex].push_back(particleIndex);
+        SetOccupied(cellIndex % m_GridWidth, cellIndex / m_GridWidth);
+    }
+
+    inline void UpdateOccupied(int cellIndex)
+    {
+        if (!m_Grid[cellIndex].empty()) return;
+        const int y = cellIndex / m_GridWidth;
+        const int x = cellIndex - y * m_GridWidth;
+        m_Occupancy[y * m_RowWords + (x >> 6)] &= ~(1ull << (x & 63));
+    }
+
+    inline void RemoveFromCell(int particleIndex, int cellIndex)
+    {
+        auto& cell = m_Grid[cellIndex];
+        for (size_t i = 0; i < cell.size(); ++i)
+        {
+            if (cell[i] == particleIndex)
+            {
+                cell[i] = cell.back();
+                cell.pop_back();
+                UpdateOccupied(cellIndex);
+                return;
+            }
+        }
+    }
+
+    // Cells filled by Update list their particles in increasing index order, these keep it
+    inline void InsertSorted(int particleIndex, int cellIndex)
+    {
+        auto& cell = m_Grid[cellIndex];
+        cell.insert(std::upper_bound(cell.begin(), cell.end(), particleIndex), particleIndex);
+        SetOccupied(cellIndex % m_GridWidth, cellIndex / m_GridWidth);
+    }
+
+    inline void EraseSorted(int particleIndex, int cellIndex)
+    {
+        auto& cell = m_Grid[cellIndex];
+        const auto it = std::lower_bound(cell.begin(), cell.end(), particleIndex);
+        if (it != cell.end() && *it == particleIndex)
+        {
+            cell.erase(it);
+            UpdateOccupied(cellIndex);
+        }
+    }
+
     // Avoid having to store useless info about potential pairs
     inline bool AreParticlesCloseEnoughSq(const Vec2& posA, const Vec2& posB, float maxDistanceSq) const
     {
@@ -46,21 +127,46 @@ public:
         m_GridWidth = static_cast<int>((maxBound.x - minBound.x) / cellSize) + 1;
         m_GridHeight = static_cast<int>((maxBound.y - minBound.y) / cellSize) + 1;
         m_Grid.resize(m_GridWidth * m_GridHeight);
+        m_CellAsleep.resize(m_GridWidth * m_GridHeight, 0);
+        m_RowWords = (m_GridWidth + 63) / 64;
+        m_Occupancy.resize(m_RowWords * m_GridHeight, 0);
+        m_ParticleCells.reserve(particleCount);
 
+        // Enough for a packed cell, so a pile forming later doesn't grow cells one by one
+        // during the steps
         const int avgParticlesPerCell = std::max(1, particleCount / (m_GridWidth * m_GridHeight));
         for (auto& cell : m_Grid) {
-            cell.reserve(avgParticlesPerCell * 2);
+            cell.reserve(std::max(avgParticlesPerCell * 2, GRID_MIN_CELL_CAPACITY));
         }
     }
 
+    // Only the occupied cells need emptying
     void Clear()
     {
-        for (auto& cell : m_Grid) {
-            cell.clear();
-        }
+        ForEachOccupiedCell([this](int, int, int cellIndex) { m_Grid[cellIndex].clear(); });
+        std::fill(m_Occupancy.begin(), m_Occupancy.end(), 0);
         m_CollisionPairs.clear();
     }
 
+    // Call function(x, y, cellIndex) for every cell holding a particle, row by row and
+    // in increasing x inside a row like a plain loop over all the cells would
+    template <class Function>
+    void ForEachOccupiedCell(Function function) const
+    {
+        for (int y = 0; y < m_GridHeight; ++y)
+        {
+            const uint64_t* row = m_Occupancy.data() + y * m_RowWords;
+            for (int word = 0; word < m_RowWords; ++word)
+            {
+                ForEachSetBit(row[word], [&](int bit)
+                {
+                    const int x = (word << 6) + bit;
+                    function(x, y, x + y * m_GridWidth);
+                });
+            }
+        }
+    }
+
     inline bool AreParticlesCloseEnough(int a, int b, const std::vector<Particle>& particles, float maxDistance) const
     {
         const auto& posA = particles[a].position;
@@ -72,58 +178,210 @@ public:
         return (dx * dx + dy * dy) <= maxDistance * maxDistance;
     }
 
+    // Clear and insert every particle
+    void Update(const std::vector<Particle>& particles) override
+    {
+        Clear();
+        const int N = static_cast<int>(particles.size());
+        const int cachedCount = m_CellsCached ? static_cast<int>(m_ParticleCells.size()) : 0;
+        int moved = std::abs(N - cachedCount);
+
+        m_ParticleCells.resize(N);
+        for (int i = 0; i < N; ++i)
+        {
+            int x, y;
+            GetCellCoords(particles[i].position, x, y);
+            const int cell = x + y * m_GridWidth;
+            if (i < cachedCount && cell != m_ParticleCells[i])
+                moved++;
+            m_ParticleCells[i] = cell;
+            m_Grid[cell].push_back(i);
+            SetOccupied(x, y);
+        }
+
+        m_MovedFraction = m_CellsCached ? (N > 0 ? static_cast<float>(moved) / N : 0.0f) : 1.0f;
+        m_CellsCached = true;
+        m_LastUpdateFull = true;
+    }
+
+    // Same cells as Update but only the particles whose cell changed since the last
+    // update are moved, particles appended or removed at the end are inserted or dropped.
+    // Cells stay sorted like a rebuild leaves them, so the pairs come out in the same
+    // order and the results don't change. When the last update saw more than
+    // GRID_INCREMENTAL_MAX_MOVED of the particles change cell this one rebuilds instead
+    void UpdateIncremental(const std::vector<Particle>& particles)
+    {
+        if (!m_CellsCached || m_MovedFraction > GRID_INCREMENTAL_MAX_MOVED)
+        {
+            Update(particles);
+            return;
+        }
+
+        m_CollisionPairs.clear();
+        const int N = static_cast<int>(particles.size());
+        const int cachedCount = static_cast<int>(m_ParticleCells.size());
+        int moved = std::abs(N - cachedCount);
+
+        for (int i = cachedCount - 1; i >= N; --i)
+            EraseSorted(i, m_ParticleCells[i]);
+        m_ParticleCells.resize(N, -1);
+
+        for (int i = 0; i < N; ++i)
+        {
+            const int cell = GetCellIndex(particles[i].position);
+            const int cached = m_ParticleCells[i];
+            if (cell == cached) continue;
+
+            if (cached >= 0)
+            {
+                EraseSorted(i, cached);
+                moved++;
+            }
+            InsertSorted(i, cell);
+            m_ParticleCells[i] = cell;
+        }
+
+        m_MovedFraction = N > 0 ? static_cast<float>(moved) / N : 0.0f;
+        m_LastUpdateFull = false;
+    }
+
+    // Fraction of the particles that changed cell (or were added / removed) since the
+    // update before, 1 when nothing was cached
+    float GetMovedFraction() const { return m_MovedFraction; }
+    bool WasLastUpdateFull() const { return m_LastUpdateFull; }
+
+    const char* GetName() const override { return "Uniform grid"; }
+
     inline void InsertParticle(int particleIndex, const Vec2& position)
     {
-        m_Grid[GetCellIndex(position)].push_back(particleIndex);
+        PushToCell(particleIndex, GetCellIndex(position));
+        m_CellsCached = false;
     }
 
+    // Insert a particle directly into a known cell (x + y * width)
+    inline void InsertParticleInCell(int particleIndex, int cellIndex)
+    {
+        PushToCell(particleIndex, cellIndex);
+        m_CellsCached = false;
+    }
+
+    // Remove a particle from a known cell, order inside the cell is not preserved
+    inline void RemoveParticleFromCell(int particleIndex, int cellIndex)
+    {
+        RemoveFromCell(particleIndex, cellIndex);
+        m_CellsCached = false;
+    }
+
+    // Move a particle to the cell of its new position if it changed, cells stay sorted
+    inline void MoveParticle(int particleIndex, const Vec2& from, const Vec2& to)
+    {
+        const int cellBefore = GetCellIndex(from);
+        const int cellAfter = GetCellIndex(to);
+        if (cellAfter != cellBefore)
+        {
+            EraseSorted(particleIndex, cellBefore);
+            InsertSorted(particleIndex, cellAfter);
+            if (m_CellsCached)
+                m_ParticleCells[particleIndex] = cellAfter;
+        }
+    }
+
+    // Compute the (clamped) cell coordinates that contain position
+    inline void GetCellCoords(const Vec2& position, int& x, int& y) const
+    {
+        x = static_cast<int>((position.x - m_MinBound.x) / m_CellSize);
+        x = (x < 0) ? 0 : ((x >= m_GridWidth) ? m_GridWidth - 1 : x);
+        y = static_cast<int>((position.y - m_MinBound.y) / m_CellSize);
+        y = (y < 0) ? 0 : ((y >= m_GridHeight) ? m_GridHeight - 1 : y);
+    }
+
+    // Append every particle stored in the cells overlapping the [minCorner, maxCorner] box
+    void QueryAABB(const Vec2& minCorner, const Vec2& maxCorner, std::vector<int>& result) const
+    {
+        int minX, minY, maxX, maxY;
+        GetCellCoords(minCorner, minX, minY);
+        GetCellCoords(maxCorner, maxX, maxY);
+        for (int y = minY; y <= maxY; ++y)
+        {
+            for (int x = minX; x <= maxX; ++x)
+            {
+                const auto& cell = m_Grid[x + y * m_GridWidth];
+                result.insert(result.end(), cell.begin(), cell.end());
+            }
+        }
+    }
+
+    const std::vector<int>& GetCell(int cellIndex) const { return m_Grid[cellIndex]; }
+    int GetCellCount() const { return m_GridWidth * m_GridHeight; }
+
+    // Pairs between two sleeping cells (or inside one) are skipped by GetPotentialCollisionPairs
+    void SetCellAsleep(int cellIndex, bool asleep) { m_CellAsleep[cellIndex] = asleep ? 1 : 0; }
+    bool IsCellAsleep(int cellIndex) const { return m_CellAsleep[cellIndex] != 0; }
+    void WakeAllCells() { std::fill(m_CellAsleep.begin(), m_CellAsleep.end(), 0); }
+    float GetCellSize() const { return m_CellSize; }
+    const Vec2& GetMinBound() const { return m_MinBound; }
+    int GetGridWidth() const { return m_GridWidth; }
+    int GetGridHeight() const { return m_GridHeight; }
+
     std::vector<std::pair<int, int>>& GetPotentialCollisionPairs(
         const std::vector<Particle>& particles,
-        float maxDistance)
+        float maxDistance) override
     {
         m_CollisionPairs.clear();
         const float maxDistanceSq = maxDistance * maxDistance;
         m_CollisionPairs.reserve(m_ParticleCount * 6);
 
-        for (int y = 0; y < m_GridHeight; ++y) 
+        // Empty cells are skipped a whole word of the occupancy bitmap at a time, above a
+        // settled pile most of the box is air
+        const int width = m_GridWidth;
+        const int height = m_GridHeight;
+        const int rowWords = m_RowWords;
+        const uint64_t* occupancy = m_Occupancy.data();
+        for (int y = 0; y < height; ++y)
         {
-            for (int x = 0; x < m_GridWidth; ++x) 
+            const uint64_t* row = occupancy + y * rowWords;
+            for (int word = 0; word < rowWords; ++word)
             {
-                const int cellIndex = x + y * m_GridWidth;
-                const auto& cellParticles = m_Grid[cellIndex];
-                if (cellParticles.empty()) continue;
-
-                const size_t cellSize = cellParticles.size();
-                for (size_t i = 0; i < cellSize; ++i) 
+                for (uint64_t bits = row[word]; bits; bits &= bits - 1)
                 {
-                    const int particleA = cellParticles[i];
-                    const Vec2& posA = particles[particleA].position;
+                    const int x = (word << 6) + CountTrailingZeros(bits);
+                    const int cellIndex = x + y * width;
+                    const auto& cellParticles = m_Grid[cellIndex];
 
-                    // Intra-cell pairs
-                    for (size_t j = i + 1; j < cellSize; ++j) 
+                    const bool cellAsleep = m_CellAsleep[cellIndex] != 0;
+                    const size_t cellSize = cellParticles.size();
+                    for (size_t i = 0; i < cellSize; ++i) 
                     {
-                        const int particleB = cellParticles[j];
-                        if (AreParticlesCloseEnoughSq(posA, particles[particleB].position, maxDistanceSq)) 
+                        const int particleA = cellParticles[i];
+                        const Vec2& posA = particles[particleA].position;
+
+                        // Intra-cell pairs
+                        for (size_t j = cellAsleep ? cellSize : i + 1; j < cellSize; ++j) 
                         {
-                            m_CollisionPairs.emplace_back(particleA, particleB);
+                            const int particleB = cellParticles[j];
+                            if (AreParticlesCloseEnoughSq(posA, particles[particleB].position, maxDistanceSq)) 
+                            {
+                                m_CollisionPairs.emplace_back(particleA, particleB);
+                            }
                         }
-                    }
 
-                    // Neighbor cells
-                    for (const auto& offset : NEIGHBOR_OFFSETS) 
-                    {
-                        const int neighborX = x + offset.first;
-                        const int neighborY = y + offset.second;
-                        if (neighborX >= m_GridWidth || neighborY >= m_GridHeight) continue;
+                        // Neighbor cells
+                        for (const auto& offset : NEIGHBOR_OFFSETS) 
+                        {
+                            const int neighborX = x + offset.first;
+                            const int neighborY = y + offset.second;
+                            if (neighborX < 0 || neighborX >= width || neighborY >= height) continue;
 
-                        const int neighborIndex = neighborX + neighborY * m_GridWidth;
-                        const auto& neighborParticles = m_Grid[neighborIndex];
-                        if (neighborParticles.empty()) continue;
+                            const int neighborIndex = neighborX + neighborY * width;
+                            const auto& neighborParticles = m_Grid[neighborIndex];
+                            if (neighborParticles.empty()) continue;
+                            if (cellAsleep && m_CellAsleep[neighborIndex]) continue;
 
-                        for (const int particleB : neighborParticles) {
-                            if (AreParticlesCloseEnoughSq(posA, particles[particleB].position, maxDistanceSq)) 
-                            {
-                                m_CollisionPairs.emplace_back(particleA, particleB);
+                            for (const int particleB : neighborParticles) {
+                                if (AreParticlesCloseEnoughSq(posA, particles[particleB].position, maxDistanceSq)) 
+                                {
+                                    m_CollisionPairs.emplace_back(particleA, particleB);
+                                }
                             }
                         }
                     }
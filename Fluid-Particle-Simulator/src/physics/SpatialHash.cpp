@@ -0,0 +1,280 @@
+#include "SpatialHash.h"
+#include <cmath>
+#include <algorithm>
+
+constexpr int SpatialHash::NEIGHBOR_OFFSETS[4][2];
+
+SpatialHash::SpatialHash(float cellSize)
+    : m_CellSize(cellSize), m_InvCellSize(1.0f / cellSize)
+{
+}
+
+int SpatialHash::FindCell(int x, int y) const
+{
+    if (m_Table.empty())
+        return -1;
+
+    unsigned int slot = HashCell(x, y) & m_TableMask;
+    while (true)
+    {
+        const int cell = m_Table[slot];
+        if (cell < 0)
+            return -1;
+        if (m_Cells[cell].x == x && m_Cells[cell].y == y)
+            return cell;
+        slot = (slot + 1) & m_TableMask;
+    }
+}
+
+template <class IndexFunction>
+void SpatialHash::Build(const std::vector<Particle>& particles, int count, IndexFunction index)
+{
+    // At most count cells, keep the load factor at or below 0.5
+    unsigned int tableSize = 16;
+    while (tableSize < 2u * static_cast<unsigned int>(count))
+        tableSize *= 2;
+    m_Table.assign(tableSize, -1);
+    m_TableMask = tableSize - 1;
+
+    m_Cells.clear();
+    m_ParticleCell.resize(count);
+
+    // Find (or create) the cell of every particle and count its particles
+    for (int k = 0; k < count; k++)
+    {
+        const Vec2& position = particles[index(k)].position;
+        const int x = GetCoord(position.x);
+        const int y = GetCoord(position.y);
+
+        unsigned int slot = HashCell(x, y) & m_TableMask;
+        int cell;
+        while (true)
+        {
+            cell = m_Table[slot];
+            if (cell < 0)
+            {
+                cell = static_cast<int>(m_Cells.size());
+                m_Table[slot] = cell;
+                m_Cells.push_back({ x, y, 0, 0 });
+                break;
+            }
+            if (m_Cells[cell].x == x && m_Cells[cell].y == y)
+                break;
+            slot = (slot + 1) & m_TableMask;
+        }
+
+        m_ParticleCell[k] = cell;
+        m_Cells[cell].count++;
+    }
+
+    // Prefix sum of the counts gives every cell its range
+    int offset = 0;
+    for (auto& cell : m_Cells)
+    {
+        cell.start = offset;
+        offset += cell.count;
+        cell.count = 0;
+    }
+
+    // Scatter, inside a cell particles stay in increasing index order
+    m_CellParticles.resize(count);
+    for (int k = 0; k < count; k++)
+    {
+        Cell& cell = m_Cells[m_ParticleCell[k]];
+        m_CellParticles[cell.start + cell.count++] = index(k);
+    }
+}
+
+int SpatialHash::AddCell(int x, int y)
+{
+    const int cell = static_cast<int>(m_Cells.size());
+    const int start = cell > 0 ? m_Cells[cell - 1].start + m_Cells[cell - 1].count : 0;
+    m_Cells.push_back({ x, y, start, 0 });
+
+    // Same load factor as Build, rehash the cells into a table twice as large
+    if (2u * m_Cells.size() > m_Table.size())
+    {
+        m_Table.assign(2 * m_Table.size(), -1);
+        m_TableMask = static_cast<unsigned int>(m_Table.size()) - 1;
+        for (int c = 0; c < cell; c++)
+        {
+            unsigned int slot = HashCell(m_Cells[c].x, m_Cells[c].y) & m_TableMask;
+            while (m_Table[slot] >= 0)
+                slot = (slot + 1) & m_TableMask;
+            m_Table[slot] = c;
+        }
+    }
+
+    unsigned int slot = HashCell(x, y) & m_TableMask;
+    while (m_Table[slot] >= 0)
+        slot = (slot + 1) & m_TableMask;
+    m_Table[slot] = cell;
+    return cell;
+}
+
+void SpatialHash::MoveParticle(int particleIndex, const Vec2& from, const Vec2& to)
+{
+    const int fromX = GetCoord(from.x);
+    const int fromY = GetCoord(from.y);
+    const int toX = GetCoord(to.x);
+    const int toY = GetCoord(to.y);
+    if (fromX == toX && fromY == toY)
+        return;
+
+    // Not stored, the hash was built from a subset without it
+    const int oldCell = FindCell(fromX, fromY);
+    if (oldCell < 0)
+        return;
+    int* const cellParticles = m_CellParticles.data();
+    int* const oldBegin = cellParticles + m_Cells[oldCell].start;
+    int* const oldEnd = oldBegin + m_Cells[oldCell].count;
+    int* const found = std::find(oldBegin, oldEnd, particleIndex);
+    if (found == oldEnd)
+        return;
+
+    int newCell = FindCell(toX, toY);
+    if (newCell < 0)
+        newCell = AddCell(toX, toY);
+
+    // Its place among the new cell's particles, in increasing index order
+    Cell& target = m_Cells[newCell];
+    int* const place = std::lower_bound(cellParticles + target.start,
+        cellParticles + target.start + target.count, particleIndex);
+
+    if (newCell > oldCell)
+    {
+        // Everything up to its place slides back a slot
+        std::rotate(found, found + 1, place);
+        for (int c = oldCell + 1; c < newCell; c++)
+            m_Cells[c].start--;
+        target.start--;
+    }
+    else
+    {
+        std::rotate(place, found, found + 1);
+        for (int c = newCell + 1; c < oldCell; c++)
+            m_Cells[c].start++;
+        m_Cells[oldCell].start++;
+    }
+    m_Cells[oldCell].count--;
+    target.count++;
+}
+
+void SpatialHash::Update(const std::vector<Particle>& particles)
+{
+    Build(particles, static_cast<int>(particles.size()), [](int k) { return k; });
+}
+
+void SpatialHash::Update(const std::vector<Particle>& particles, const std::vector<int>& indices)
+{
+    const int* subset = indices.data();
+    Build(particles, static_cast<int>(indices.size()), [subset](int k) { return subset[k]; });
+}
+
+void SpatialHash::TestCellPair(const Cell& a, const Cell& b, const std::vector<Particle>& particles, float maxDistanceSq)
+{
+    for (int i = a.start; i < a.start + a.count; i++)
+    {
+        const int particleA = m_CellParticles[i];
+        const Vec2& posA = particles[particleA].position;
+        for (int j = b.start; j < b.start + b.count; j++)
+        {
+            const int particleB = m_CellParticles[j];
+            const float dx = posA.x - particles[particleB].position.x;
+            const float dy = posA.y - particles[particleB].position.y;
+            if (dx * dx + dy * dy <= maxDistanceSq)
+                m_CollisionPairs.emplace_back(particleA, particleB);
+        }
+    }
+}
+
+std::vector<std::pair<int, int>>& SpatialHash::GetPotentialCollisionPairs(
+    const std::vector<Particle>& particles,
+    float maxDistance)
+{
+    const float maxDistanceSq = maxDistance * maxDistance;
+    m_CollisionPairs.clear();
+    m_CollisionPairs.reserve(particles.size() * 3);
+
+    for (const Cell& cell : m_Cells)
+    {
+        // Intra-cell pairs
+        for (int i = cell.start; i < cell.start + cell.count; i++)
+        {
+            const int particleA = m_CellParticles[i];
+            const Vec2& posA = particles[particleA].position;
+            for (int j = i + 1; j < cell.start + cell.count; j++)
+            {
+                const int particleB = m_CellParticles[j];
+                const float dx = posA.x - particles[particleB].position.x;
+                const float dy = posA.y - particles[particleB].position.y;
+                if (dx * dx + dy * dy <= maxDistanceSq)
+                    m_CollisionPairs.emplace_back(particleA, particleB);
+            }
+        }
+
+        // Neighbor cells, empty ones aren't in the table
+        for (const auto& offset : NEIGHBOR_OFFSETS)
+        {
+            const int neighbor = FindCell(cell.x + offset[0], cell.y + offset[1]);
+            if (neighbor >= 0)
+                TestCellPair(cell, m_Cells[neighbor], particles, maxDistanceSq);
+        }
+    }
+    return m_CollisionPairs;
+}
+
+void SpatialHash::QueryAABB(const Vec2& minCorner, const Vec2& maxCorner, std::vector<int>& result) const
+{
+    const int minX = GetCoord(minCorner.x);
+    const int minY = GetCoord(minCorner.y);
+    const int maxX = GetCoord(maxCorner.x);
+    const int maxY = GetCoord(maxCorner.y);
+
+    // A huge box covers more cells than there are occupied ones, walk those instead
+    const long long boxCells = (static_cast<long long>(maxX) - minX + 1) * (static_cast<long long>(maxY) - minY + 1);
+    if (boxCells > static_cast<long long>(m_Cells.size()))
+    {
+        for (const Cell& cell : m_Cells)
+        {
+            if (cell.x < minX || cell.x > maxX || cell.y < minY || cell.y > maxY) continue;
+            result.insert(result.end(), m_CellParticles.begin() + cell.start,
+                m_CellParticles.begin() + cell.start + cell.count);
+        }
+        return;
+    }
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        for (int x = minX; x <= maxX; x++)
+        {
+            const int cell = FindCell(x, y);
+            if (cell < 0) continue;
+            result.insert(result.end(), m_CellParticles.begin() + m_Cells[cell].start,
+                m_CellParticles.begin() + m_Cells[cell].start + m_Cells[cell].count);
+        }
+    }
+}
+
+const int* SpatialHash::GetCellParticles(int x, int y, int& count) const
+{
+    const int cell = FindCell(x, y);
+    if (cell < 0)
+    {
+        count = 0;
+        return nullptr;
+    }
+    count = m_Cells[cell].count;
+    return m_CellParticles.data() + m_Cells[cell].start;
+}
+
+float SpatialHash::GetMeanOccupancy() const
+{
+    if (m_CellParticles.empty())
+        return 0.0f;
+
+    double sharedSum = 0.0;
+    for (const Cell& cell : m_Cells)
+        sharedSum += static_cast<double>(cell.count) * cell.count;
+    return static_cast<float>(sharedSum / m_CellParticles.size());
+}
\ No newline at end of file
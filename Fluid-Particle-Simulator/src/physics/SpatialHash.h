@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <cmath>
+#include "Broadphase.h"
+
+// Sparse version of SpatialGrid. Only occupied cells exist, they're found through an
+// open addressing hash table keyed by the integer cell coordinates and sized from
+// the particle count, so memory and clear cost scale with the particles and not with
+// the domain area. Cells have no bounds either, any position maps to its own cell,
+// which is what unbounded simulations need.
+//
+// Particle indices are stored grouped by cell in one flat array (counting sort), each
+// cell keeps the start and length of its range
+class SpatialHash : public Broadphase {
+private:
+    struct Cell {
+        int x;
+        int y;
+        int start;
+        int count;
+    };
+
+    float m_CellSize;
+    float m_InvCellSize;
+
+    std::vector<int> m_Table;          // index into m_Cells, -1 for an empty slot
+    unsigned int m_TableMask = 0;
+    std::vector<Cell> m_Cells;         // occupied cells, in order of first appearance
+    std::vector<int> m_ParticleCell;   // cell of every stored particle
+    std::vector<int> m_CellParticles;  // particle indices grouped by cell
+    std::vector<std::pair<int, int>> m_CollisionPairs;
+
+    // Half of the 8 neighbours so every pair of cells is visited once
+    static constexpr int NEIGHBOR_OFFSETS[4][2] = { {1, 0}, {1, 1}, {0, 1}, {-1, 1} };
+
+    static inline unsigned int HashCell(int x, int y)
+    {
+        return static_cast<unsigned int>(x) * 73856093u ^ static_cast<unsigned int>(y) * 19349663u;
+    }
+
+    // Index into m_Cells of the cell (x, y), -1 if it holds no particle
+    int FindCell(int x, int y) const;
+
+    // Append an empty cell (x, y) after the last range, the table grows to stay half empty
+    int AddCell(int x, int y);
+
+    // Fill the table with count particles, the k-th one being particles[index(k)]
+    template <class IndexFunction>
+    void Build(const std::vector<Particle>& particles, int count, IndexFunction index);
+
+    void TestCellPair(const Cell& a, const Cell& b, const std::vector<Particle>& particles, float maxDistanceSq);
+
+public:
+    // cellSize has to be at least the largest maxDistance used for queries
+    explicit SpatialHash(float cellSize);
+
+    // Rebuild the table from scratch, O(N)
+    void Update(const std::vector<Particle>& particles) override;
+
+    // Rebuild from a subset of the particles only, pairs and queries then only see those
+    void Update(const std::vector<Particle>& particles, const std::vector<int>& indices);
+
+    std::vector<std::pair<int, int>>& GetPotentialCollisionPairs(
+        const std::vector<Particle>& particles,
+        float maxDistance) override;
+
+    const char* GetName() const override { return "Spatial hash"; }
+
+    // Append every particle stored in the cells overlapping the [minCorner, maxCorner] box
+    void QueryAABB(const Vec2& minCorner, const Vec2& maxCorner, std::vector<int>& result) const;
+
+    // Move a particle to the cell of its new position if it changed, cells stay sorted.
+    // Ranges follow each other in m_Cells order, so the slots between the old and the new
+    // place shift by one, O(particles stored between the two cells)
+    void MoveParticle(int particleIndex, const Vec2& from, const Vec2& to);
+
+    // Integer cell coordinate of a position along one axis
+    inline int GetCoord(float position) const
+    {
+        return static_cast<int>(std::floor(position * m_InvCellSize));
+    }
+
+    // Particles stored in the cell (x, y), null with count 0 if it's empty
+    const int* GetCellParticles(int x, int y, int& count) const;
+
+    float GetCellSize() const { return m_CellSize; }
+    int GetOccupiedCellCount() const { return static_cast<int>(m_Cells.size()); }
+
+    // Average number of particles sharing a cell with a particle (sum of count^2 / N)
+    float GetMeanOccupancy() const;
+};
\ No newline at end of file
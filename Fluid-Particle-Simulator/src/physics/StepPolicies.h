@@ -0,0 +1,301 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include "SimulationSystem.h"
+#include "SolveCollision.h"
+#include "../core/FrameArena.h"
+#include "../core/PhaseProfiler.h"
+
+// Compile-time policies used to build the specialised step kernels in Physics.cpp.
+// Every combination is instantiated once and selected at runtime, so the hot loops
+// contain no branches on settings and no divisions the compiler can't hoist.
+
+// Everything the kernels need, computed once per step instead of per particle
+struct StepContext
+{
+    Bounds bounds;
+    float deltaTime;
+    float particleRadius;
+    float diameter;
+    float diameterSq;
+    float maxRadius;     // largest radius, equals particleRadius with UniformRadius
+    float pairDistance;  // broadphase distance, the largest possible contact distance
+    float mass;          // only meaningful with UniformMass
+    BroadphaseType broadphase;
+    SolverType solver;
+    bool deterministic;  // solve the canonical pair list, see SimulationSystem::SetDeterministic
+    bool useBorders;     // false for unbounded simulations
+    bool incrementalGrid;
+
+    // Declared attribute columns, null when the channel isn't allocated
+    const float* masses;
+    const float* radii;
+    float* temperatures;
+    int* restSteps;
+    unsigned char* sleeping;
+
+    bool useSleeping;
+    float sleepSpeedSq;
+    int sleepSteps;
+
+    bool useCCD;
+    float ccdSpeedSq;
+
+    // Scratch memory of this step, reset before the next one
+    FrameArena* arena;
+
+    // Null unless the phases are being timed
+    PhaseProfiler* profiler;
+};
+
+// Pairs handed to the solvers, either the broadphase list or a canonical copy in the arena
+struct PairList
+{
+    const std::pair<int, int>* data;
+    int count;
+
+    const std::pair<int, int>* begin() const { return data; }
+    const std::pair<int, int>* end() const { return data + count; }
+    const std::pair<int, int>& operator[](int k) const { return data[k]; }
+};
+
+// ---------- Integrators ----------
+// Update the velocity and return the displacement of the step
+
+struct SemiImplicitEuler
+{
+    static inline Vec2 Step(Vec2& velocity, const Vec2& acceleration, float dt)
+    {
+        velocity.x += acceleration.x * dt;
+        velocity.y += acceleration.y * dt;
+        return { velocity.x * dt, velocity.y * dt };
+    }
+};
+
+struct VelocityVerlet
+{
+    // Exact for constant acceleration
+    static inline Vec2 Step(Vec2& velocity, const Vec2& acceleration, float dt)
+    {
+        const Vec2 displacement(
+            (velocity.x + 0.5f * acceleration.x * dt) * dt,
+            (velocity.y + 0.5f * acceleration.y * dt) * dt);
+        velocity.x += acceleration.x * dt;
+        velocity.y += acceleration.y * dt;
+        return displacement;
+    }
+};
+
+// ---------- Mass ----------
+// Policies take particle indices so the per-particle variant can read the mass column
+
+struct UniformMass
+{
+    float mass;
+    float invMass;
+
+    explicit UniformMass(const StepContext& ctx) : mass(ctx.mass), invMass(1.0f / ctx.mass) {}
+
+    inline float InvMass(int) const { return invMass; }
+
+    // Share of the overlap each particle moves
+    inline void CorrectionRatios(int, int, float& ratioA, float& ratioB) const
+    {
+        ratioA = 0.5f;
+        ratioB = 0.5f;
+    }
+
+    // Impulse magnitude and the velocity change it produces on each particle
+    inline float Impulse(int, int, float impulseScalar) const
+    {
+        return impulseScalar * 0.5f * mass;
+    }
+    inline void VelocityFactors(int, int, float impulseScalar, float& factorA, float& factorB) const
+    {
+        factorA = impulseScalar * 0.5f;
+        factorB = impulseScalar * 0.5f;
+    }
+};
+
+struct PerParticleMass
+{
+    const float* masses;
+
+    explicit PerParticleMass(const StepContext& ctx) : masses(ctx.masses) {}
+
+    inline float InvMass(int i) const { return 1.0f / masses[i]; }
+
+    inline void CorrectionRatios(int a, int b, float& ratioA, float& ratioB) const
+    {
+        const float invTotalMass = 1.0f / (masses[a] + masses[b]);
+        ratioA = masses[b] * invTotalMass;
+        ratioB = masses[a] * invTotalMass;
+    }
+
+    inline float Impulse(int a, int b, float impulseScalar) const
+    {
+        return impulseScalar / (1.0f / masses[a] + 1.0f / masses[b]);
+    }
+    inline void VelocityFactors(int a, int b, float impulseScalar, float& factorA, float& factorB) const
+    {
+        const float impulse = Impulse(a, b, impulseScalar);
+        factorA = impulse / masses[a];
+        factorB = impulse / masses[b];
+    }
+};
+
+// ---------- Radius ----------
+// Contact distance of a pair, the sum of the two radii
+
+struct UniformRadius
+{
+    float radius;
+    float diameter;
+    float diameterSq;
+
+    explicit UniformRadius(const StepContext& ctx)
+        : radius(ctx.particleRadius), diameter(ctx.diameter), diameterSq(ctx.diameterSq) {}
+
+    inline float Radius(int) const { return radius; }
+    inline float ContactDistance(int, int) const { return diameter; }
+    inline float ContactDistanceSq(int, int) const { return diameterSq; }
+};
+
+struct PerParticleRadius
+{
+    const float* radii;
+
+    explicit PerParticleRadius(const StepContext& ctx) : radii(ctx.radii) {}
+
+    inline float Radius(int i) const { return radii[i]; }
+    inline float ContactDistance(int a, int b) const { return radii[a] + radii[b]; }
+    inline float ContactDistanceSq(int a, int b) const
+    {
+        const float distance = radii[a] + radii[b];
+        return distance * distance;
+    }
+};
+
+// ---------- Temperature ----------
+
+struct TemperatureOn
+{
+    static const bool Enabled = true;
+    float* temperatures;
+
+    explicit TemperatureOn(const StepContext& ctx) : temperatures(ctx.temperatures) {}
+
+    inline void Integrate(int i, float speedSq) const
+    {
+        if (speedSq > 25.0f)
+            temperatures[i] = std::min(100.0f, temperatures[i] + 0.1f);
+        else
+            temperatures[i] = std::max(AMBIENT_TEMPERATURE, temperatures[i] - 0.05f);
+    }
+
+    // Heating of one particle from the impulses it received
+    inline void Heat(int i, float impulse) const
+    {
+        temperatures[i] = std::min(100.0f, temperatures[i] + impulse * 0.01f);
+    }
+
+    inline void Collision(int a, int b, float impulse) const
+    {
+        Heat(a, impulse);
+        Heat(b, impulse);
+    }
+};
+
+struct TemperatureOff
+{
+    static const bool Enabled = false;
+
+    explicit TemperatureOff(const StepContext&) {}
+
+    inline void Integrate(int, float) const {}
+    inline void Heat(int, float) const {}
+    inline void Collision(int, int, float) const {}
+};
+
+// ---------- Pair solver ----------
+
+// Response of one contact computed from the current state, before anything moves:
+// collision normal, overlap and the share of it each particle takes, and the velocity
+// change along the normal when the particles approach each other
+struct Contact
+{
+    float nx;
+    float ny;
+    float overlap;
+    float ratioA;
+    float ratioB;
+    bool approaching;
+    float impulseScalar;
+    float factorA;
+    float factorB;
+};
+
+// Same model as SolveCollisionParticle, false when the particles don't touch
+template <class MassPolicy, class RadiusPolicy>
+inline bool ComputeContact(const Particle& a, const Particle& b, int indexA, int indexB,
+    const MassPolicy& mass, const RadiusPolicy& radius, Contact& contact)
+{
+    const float dx = a.position.x - b.position.x;
+    const float dy = a.position.y - b.position.y;
+    const float distanceSquared = dx * dx + dy * dy;
+    if (distanceSquared >= radius.ContactDistanceSq(indexA, indexB))
+        return false;
+
+    const float distance = std::sqrt(distanceSquared);
+    if (distance < 1e-5f)
+        return false;
+
+    const float invDistance = 1.0f / distance;
+    contact.nx = dx * invDistance;
+    contact.ny = dy * invDistance;
+
+    // Position correction
+    contact.overlap = radius.ContactDistance(indexA, indexB) - distance;
+    mass.CorrectionRatios(indexA, indexB, contact.ratioA, contact.ratioB);
+
+    // Velocity resolution
+    const float vx = a.velocity.x - b.velocity.x;
+    const float vy = a.velocity.y - b.velocity.y;
+    const float velocityAlongNormal = vx * contact.nx + vy * contact.ny;
+    contact.approaching = velocityAlongNormal < 0.0f;
+    if (contact.approaching)
+    {
+        contact.impulseScalar = -(1.0f + BOUNCINESS) * velocityAlongNormal;
+        mass.VelocityFactors(indexA, indexB, contact.impulseScalar, contact.factorA, contact.factorB);
+    }
+    return true;
+}
+
+// Gauss-Seidel: push overlapping particles apart and apply the restitution impulse
+// right away, the next pair already sees the result
+template <class MassPolicy, class RadiusPolicy, class ThermalPolicy>
+inline void SolvePair(std::vector<Particle>& particles, int indexA, int indexB,
+    const MassPolicy& mass, const RadiusPolicy& radius, const ThermalPolicy& thermal)
+{
+    Particle& a = particles[indexA];
+    Particle& b = particles[indexB];
+
+    Contact contact{};
+    if (!ComputeContact(a, b, indexA, indexB, mass, radius, contact))
+        return;
+
+    a.position.x += contact.nx * contact.overlap * contact.ratioA;
+    a.position.y += contact.ny * contact.overlap * contact.ratioA;
+    b.position.x -= contact.nx * contact.overlap * contact.ratioB;
+    b.position.y -= contact.ny * contact.overlap * contact.ratioB;
+
+    if (contact.approaching)
+    {
+        a.velocity.x += contact.factorA * contact.nx;
+        a.velocity.y += contact.factorA * contact.ny;
+        b.velocity.x -= contact.factorB * contact.nx;
+        b.velocity.y -= contact.factorB * contact.ny;
+
+        thermal.Collision(indexA, indexB, mass.Impulse(indexA, indexB, contact.impulseScalar));
+    }
+}
@@ -0,0 +1,141 @@
+#include "SweepAndPrune.h"
+#include <algorithm>
+#include <cmath>
+
+// Give up on the insertion sort once it did this many swaps per particle, the order
+// was too far off (first update, teleports, big spawn bursts) and a full sort is cheaper
+const int MAX_SWAPS_PER_PARTICLE = 16;
+
+void SweepAndPrune::FullSort(const std::vector<Particle>& particles)
+{
+    const int N = static_cast<int>(particles.size());
+    m_Order.resize(N);
+    for (int i = 0; i < N; i++)
+        m_Order[i] = i;
+
+    // Ties broken by index so the order only depends on the positions
+    std::sort(m_Order.begin(), m_Order.end(), [&](int a, int b)
+    {
+        const float xa = particles[a].position.x;
+        const float xb = particles[b].position.x;
+        return xa < xb || (xa == xb && a < b);
+    });
+
+    m_SortedX.resize(N);
+    for (int k = 0; k < N; k++)
+        m_SortedX[k] = particles[m_Order[k]].position.x;
+
+    m_LastFullSort = true;
+    m_LastSwapCount = 0;
+}
+
+void SweepAndPrune::Update(const std::vector<Particle>& particles)
+{
+    const int N = static_cast<int>(particles.size());
+    const int previousN = static_cast<int>(m_Order.size());
+
+    if (previousN == 0 || previousN > N)
+    {
+        // Nothing to start from, or particles were removed and the indices are stale
+        FullSort(particles);
+    }
+    else
+    {
+        // New particles are appended and sorted in with the rest
+        m_Order.resize(N);
+        for (int i = previousN; i < N; i++)
+            m_Order[i] = i;
+
+        // Refresh the keys in last step's order, it's nearly sorted
+        m_SortedX.resize(N);
+        for (int k = 0; k < N; k++)
+            m_SortedX[k] = particles[m_Order[k]].position.x;
+
+        const long long maxSwaps = static_cast<long long>(MAX_SWAPS_PER_PARTICLE) * N;
+        long long swaps = 0;
+        float* keys = m_SortedX.data();
+        int* order = m_Order.data();
+
+        for (int k = 1; k < N && swaps <= maxSwaps; k++)
+        {
+            const float key = keys[k];
+            const int index = order[k];
+            int m = k;
+            while (m > 0 && (keys[m - 1] > key || (keys[m - 1] == key && order[m - 1] > index)))
+            {
+                keys[m] = keys[m - 1];
+                order[m] = order[m - 1];
+                m--;
+            }
+            keys[m] = key;
+            order[m] = index;
+            swaps += k - m;
+        }
+
+        if (swaps > maxSwaps)
+        {
+            FullSort(particles);
+        }
+        else
+        {
+            m_LastFullSort = false;
+            m_LastSwapCount = swaps;
+        }
+    }
+
+    m_SortedY.resize(N);
+    for (int k = 0; k < N; k++)
+        m_SortedY[k] = particles[m_Order[k]].position.y;
+}
+
+std::vector<std::pair<int, int>>& SweepAndPrune::GetPotentialCollisionPairs(
+    const std::vector<Particle>& /*particles*/,
+    float maxDistance)
+{
+    const int N = static_cast<int>(m_Order.size());
+    const float maxDistanceSq = maxDistance * maxDistance;
+    const float* x = m_SortedX.data();
+    const float* y = m_SortedY.data();
+
+    m_CollisionPairs.clear();
+    m_CollisionPairs.reserve(N * 3);
+
+    // Active list: the sorted range [first, k) of particles still within maxDistance
+    // along x of particle k. Since the list is sorted it only ever shrinks from the front
+    int first = 0;
+    for (int k = 0; k < N; k++)
+    {
+        const float xk = x[k];
+        const float yk = y[k];
+        while (x[first] < xk - maxDistance)
+            first++;
+
+        for (int m = first; m < k; m++)
+        {
+            const float dy = y[m] - yk;
+            if (std::abs(dy) > maxDistance) continue;
+
+            const float dx = xk - x[m];
+            if (dx * dx + dy * dy <= maxDistanceSq)
+                m_CollisionPairs.emplace_back(m_Order[m], m_Order[k]);
+        }
+    }
+    return m_CollisionPairs;
+}
+
+float SweepAndPrune::MeasureActiveLength(float maxDistance) const
+{
+    const int N = static_cast<int>(m_SortedX.size());
+    if (N == 0)
+        return 0.0f;
+
+    long long total = 0;
+    int first = 0;
+    for (int k = 0; k < N; k++)
+    {
+        while (m_SortedX[first] < m_SortedX[k] - maxDistance)
+            first++;
+        total += k - first;
+    }
+    return static_cast<float>(static_cast<double>(total) / N);
+}
\ No newline at end of file
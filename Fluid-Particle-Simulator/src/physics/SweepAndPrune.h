@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include "Broadphase.h"
+
+// Sort and sweep broadphase. Particles are kept sorted along x, between two steps
+// they barely move so the order from the last Update is almost right and an
+// insertion sort fixes it in close to O(N). The sweep then walks the sorted list
+// with an active list of the particles whose x is still within maxDistance of the
+// current one, only those are tested. Unlike the uniform grid it costs nothing for
+// empty space and doesn't care how crowded a region gets, only how many particles
+// share a column of width maxDistance
+class SweepAndPrune : public Broadphase {
+private:
+    std::vector<int> m_Order;      // particle indices sorted by x
+    std::vector<float> m_SortedX;  // positions in sorted order, for the sweep
+    std::vector<float> m_SortedY;
+    std::vector<std::pair<int, int>> m_CollisionPairs;
+
+    // Swaps done by the last insertion sort (0 after a full sort)
+    long long m_LastSwapCount = 0;
+    bool m_LastFullSort = false;
+
+    void FullSort(const std::vector<Particle>& particles);
+
+public:
+    void Update(const std::vector<Particle>& particles) override;
+
+    std::vector<std::pair<int, int>>& GetPotentialCollisionPairs(
+        const std::vector<Particle>& particles,
+        float maxDistance) override;
+
+    const char* GetName() const override { return "Sweep and prune"; }
+
+    // Average length of the active list for maxDistance, without testing any pair
+    float MeasureActiveLength(float maxDistance) const;
+
+    long long GetLastSwapCount() const { return m_LastSwapCount; }
+    bool WasLastSortFull() const { return m_LastFullSort; }
+};
\ No newline at end of file
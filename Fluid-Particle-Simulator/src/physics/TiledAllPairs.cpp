@@ -0,0 +1,86 @@
+#include "TiledAllPairs.h"
+#include <algorithm>
+
+// SSE2 is always there on x64 and is the MSVC default on Win32 since VS2012
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ALL_PAIRS_USE_SSE 1
+#endif
+
+void TiledAllPairs::TestTile(int beginI, int endI, int beginJ, int endJ, float maxDistanceSq)
+{
+    const float* x = m_X.data();
+    const float* y = m_Y.data();
+
+    for (int i = beginI; i < endI; i++)
+    {
+        const float xi = x[i];
+        const float yi = y[i];
+
+        // Only j > i, on the diagonal tile this skips the lower triangle
+        int j = std::max(beginJ, i + 1);
+
+#ifdef ALL_PAIRS_USE_SSE
+        const __m128 xi4 = _mm_set1_ps(xi);
+        const __m128 yi4 = _mm_set1_ps(yi);
+        const __m128 maxDistanceSq4 = _mm_set1_ps(maxDistanceSq);
+
+        for (; j + 4 <= endJ; j += 4)
+        {
+            const __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + j), xi4);
+            const __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + j), yi4);
+            const __m128 distanceSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+            // Most lanes miss, only look at the mask when something hit
+            const int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSq, maxDistanceSq4));
+            if (mask == 0) continue;
+
+            if (mask & 1) m_CollisionPairs.emplace_back(i, j);
+            if (mask & 2) m_CollisionPairs.emplace_back(i, j + 1);
+            if (mask & 4) m_CollisionPairs.emplace_back(i, j + 2);
+            if (mask & 8) m_CollisionPairs.emplace_back(i, j + 3);
+        }
+#endif
+
+        // Scalar tail (and the whole row without SSE)
+        for (; j < endJ; j++)
+        {
+            const float dx = x[j] - xi;
+            const float dy = y[j] - yi;
+            if (dx * dx + dy * dy <= maxDistanceSq)
+                m_CollisionPairs.emplace_back(i, j);
+        }
+    }
+}
+
+void TiledAllPairs::Update(const std::vector<Particle>& particles)
+{
+    // Structure of arrays copy so 4 consecutive positions load in one instruction
+    const int N = static_cast<int>(particles.size());
+    m_X.resize(N);
+    m_Y.resize(N);
+    for (int i = 0; i < N; i++)
+    {
+        m_X[i] = particles[i].position.x;
+        m_Y[i] = particles[i].position.y;
+    }
+}
+
+std::vector<std::pair<int, int>>& TiledAllPairs::GetPotentialCollisionPairs(
+    const std::vector<Particle>& /*particles*/,
+    float maxDistance)
+{
+    const int N = static_cast<int>(m_X.size());
+    const float maxDistanceSq = maxDistance * maxDistance;
+
+    m_CollisionPairs.clear();
+    m_CollisionPairs.reserve(N * 3);
+
+    for (int beginI = 0; beginI < N; beginI += TILE_SIZE)
+    {
+        const int endI = std::min(beginI + TILE_SIZE, N);
+        for (int beginJ = beginI; beginJ < N; beginJ += TILE_SIZE)
+            TestTile(beginI, endI, beginJ, std::min(beginJ + TILE_SIZE, N), maxDistanceSq);
+    }
+    return m_CollisionPairs;
+}
\ No newline at end of file
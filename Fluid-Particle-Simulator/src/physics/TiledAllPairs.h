@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include "Broadphase.h"
+
+// Brute force broadphase for small and medium particle counts. Every unordered pair
+// (i < j) is tested once, positions are copied into x/y arrays so 4 pairs are tested
+// per SSE instruction, and the pair loops are blocked in tiles so the j tile stays in
+// L1 while every particle of the i tile is tested against it. There's no structure to
+// build or scan, for small scenes this beats the fixed cost of the grid.
+class TiledAllPairs : public Broadphase {
+private:
+    // Particles per tile, two tiles of x/y floats take 4KB
+    static const int TILE_SIZE = 256;
+
+    std::vector<float> m_X;
+    std::vector<float> m_Y;
+    std::vector<std::pair<int, int>> m_CollisionPairs;
+
+    void TestTile(int beginI, int endI, int beginJ, int endJ, float maxDistanceSq);
+
+public:
+    // Copy the positions into the x/y arrays
+    void Update(const std::vector<Particle>& particles) override;
+
+    // Pairs are reported as (i, j) with i < j, tile by tile, always in the same order
+    // for the same input
+    std::vector<std::pair<int, int>>& GetPotentialCollisionPairs(
+        const std::vector<Particle>& particles,
+        float maxDistance) override;
+
+    const char* GetName() const override { return "All pairs"; }
+};
\ No newline at end of file